@@ -0,0 +1,198 @@
+#pragma once
+
+#include "mispdlog/common.h"
+#include "mispdlog/details/async_msg.h"
+#include "mispdlog/details/log_message.h"
+#include "mispdlog/details/mpsc_queue.h"
+#include "mispdlog/logger.h"
+#include "mispdlog/sinks/base_sink.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mispdlog {
+
+/**
+ * @brief what to do when the async queue is full
+ *
+ */
+enum class async_overflow_policy : std::uint8_t {
+  block,         // 等待后台线程腾出空间
+  discard_new,   // 丢弃当前消息
+  overrun_oldest // 覆盖最旧的消息
+};
+
+/**
+ * @brief how producer threads hand messages to the backend thread
+ *
+ */
+enum class async_queue_mode : std::uint8_t {
+  shared,    // 所有线程共用一个有界 MPSC 队列
+  per_thread // 每个生产线程一个 SPSC 环,后台按时间归并
+};
+
+namespace details {
+struct producer_ring;
+} // namespace details
+
+/**
+ * @brief async_logger: log() only copies the message into a bounded lock-free
+ * queue, a dedicated backend thread drains it into the sinks.
+ * In async_queue_mode::per_thread every producer thread lazily gets its own
+ * SPSC ring of ring_size entries (registered once under a mutex), so a push
+ * shares no cache line with other producers; the backend k-way merges the
+ * ring heads by log_message::time. Records are ordered by time among those
+ * visible to the backend; a producer preempted between taking the timestamp
+ * and pushing may land slightly out of order. A ring is reclaimed after its
+ * thread exits and the backend has drained it; the slots of every ring are
+ * freed when the logger is destroyed. overrun_oldest needs to evict
+ * from the producer side and is not available in this mode.
+ *
+ */
+class MISPDLOG_API async_logger : public logger {
+public:
+  static constexpr size_t default_queue_size = 8192;
+  // 每个生产线程一个环,占用 ring_size * sizeof(async_msg),远小于共享队列
+  static constexpr size_t default_ring_size = 256;
+
+  /**
+   * @brief
+   *
+   * @param name
+   * @param single_sink
+   * @param queue_size shared queue length, unused in per_thread mode
+   * @param policy
+   * @param mode
+   * @param ring_size per_thread mode: capacity of each producer thread's
+   * ring, allocated on the thread's first log call; a full ring blocks or
+   * drops by policy, so size it for one thread's burst, not the total rate
+   * @throw std::invalid_argument for overrun_oldest in per_thread mode
+   */
+  async_logger(std::string name, sinks::sink_ptr single_sink,
+               size_t queue_size = default_queue_size,
+               async_overflow_policy policy = async_overflow_policy::block,
+               async_queue_mode mode = async_queue_mode::shared,
+               size_t ring_size = default_ring_size);
+  async_logger(std::string name, std::vector<sinks::sink_ptr> sinks,
+               size_t queue_size = default_queue_size,
+               async_overflow_policy policy = async_overflow_policy::block,
+               async_queue_mode mode = async_queue_mode::shared,
+               size_t ring_size = default_ring_size);
+
+  /**
+   * @brief drain the remaining messages and join the backend thread
+   *
+   */
+  ~async_logger() override;
+
+  async_overflow_policy overflow_policy() const;
+  async_queue_mode queue_mode() const;
+
+  /**
+   * @brief messages lost by discard_new / overrun_oldest
+   *
+   * @return size_t
+   */
+  size_t dropped_count() const;
+
+protected:
+  void sink_it_(const details::log_message &message) override;
+
+  /**
+   * @brief enqueue a flush request and wait until the backend has done it
+   *
+   */
+  void flush_() override;
+
+  /**
+   * @brief enqueue the unformatted record, process_ renders it
+   *
+   * @param record
+   */
+  void sink_deferred_(details::async_msg &&record) override;
+
+private:
+  void start_worker_();
+  void worker_loop_();
+
+  /**
+   * @brief put msg on the queue according to the overflow policy
+   *
+   * @param msg
+   */
+  void enqueue_(details::async_msg &&msg);
+
+  /**
+   * @brief overrun_oldest: evict log messages until msg fits; evicted
+   * control messages are put back, only the backend completes them
+   *
+   * @param msg
+   */
+  void overrun_enqueue_(details::async_msg &&msg);
+
+  /**
+   * @brief the calling thread's ring, created and registered on first use
+   *
+   * @return details::producer_ring&
+   */
+  details::producer_ring &local_ring_();
+
+  /**
+   * @brief per_thread mode: push to the calling thread's ring
+   *
+   * @param msg
+   * @param block wait for room instead of dropping
+   */
+  void enqueue_ring_(details::async_msg &&msg, bool block);
+
+  /**
+   * @brief backend: pick up new rings, k-way merge the ring heads by time
+   * and reclaim rings of exited threads
+   *
+   * @return true when any message was processed
+   */
+  bool merge_rings_();
+  /**
+   * @brief process one message on the backend thread
+   *
+   * @return false when the worker should exit
+   */
+  bool process_(const details::async_msg &msg);
+  void backend_sink_it_(const details::log_message &message);
+  void backend_flush_(std::uint64_t flush_id);
+
+private:
+  details::mpsc_queue<details::async_msg> queue_;
+  async_overflow_policy policy_;
+  std::atomic<size_t> dropped_{0};
+
+  // flush 请求按 id 递增,后台完成后通知等待者; 标记可能乱序处理(归并、
+  // 溢出时重新入队),所以按 id 逐个记录,等待者只认自己的 id
+  std::atomic<std::uint64_t> flush_requested_{0};
+  std::vector<std::uint64_t> flush_done_;
+  std::mutex flush_mutex_;
+  std::condition_variable flush_cv_;
+
+  // per_thread 模式
+  async_queue_mode mode_;
+  size_t ring_size_;
+  std::uint64_t id_; // 线程本地环表按 id 查找,logger 地址可能被复用
+  std::mutex rings_mutex_;
+  std::vector<std::shared_ptr<details::producer_ring>> pending_rings_;
+  std::atomic<bool> rings_pending_{false};
+  // 以下只由后台线程访问
+  std::vector<std::shared_ptr<details::producer_ring>> rings_;
+  std::vector<std::pair<log_clock::time_point, size_t>> merge_heap_;
+  std::atomic<bool> stop_{false};
+
+  std::thread worker_;
+};
+} // namespace mispdlog
@@ -1,13 +1,24 @@
 #pragma once
 
 #include <chrono>
+#include <fmt/format.h>
 #include <string>
+#include <string_view>
+
+// 格式化 buffer 的栈上容量,超过才会退化到堆分配; 默认不小于
+// fmt::memory_buffer 的 500 字节,调小(例如缩减异步队列槽位)需显式定义
+#ifndef MISPDLOG_INLINE_BUFFER_SIZE
+#define MISPDLOG_INLINE_BUFFER_SIZE 512
+#endif
 
 namespace mispdlog {
 
 // 别名
-using string_view_t = std::string; // for c++11
+using string_view_t = std::string_view; // 非拥有视图,不拷贝
 using log_clock = std::chrono::high_resolution_clock;
+// 从 logger::log 到 sink 的 fwrite 全程使用的 small-buffer 类型
+using memory_buf_t =
+    fmt::basic_memory_buffer<char, MISPDLOG_INLINE_BUFFER_SIZE>;
 
 // os
 #ifdef _WIN32
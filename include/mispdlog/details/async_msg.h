@@ -0,0 +1,109 @@
+#pragma once
+
+#include "mispdlog/common.h"
+#include "mispdlog/details/deferred_args.h"
+#include "mispdlog/details/log_message.h"
+#include "mispdlog/level.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fmt/format.h>
+
+namespace mispdlog {
+namespace details {
+
+enum class async_msg_type : std::uint8_t {
+  log,      // 普通日志
+  flush,    // 刷新请求
+  terminate // 后台线程退出
+};
+
+/**
+ * @brief queue element of async_logger, owns a copy of the payload so it can
+ * outlive the log() call; logger_name is not copied since the async_logger
+ * owning the queue also owns the name
+ *
+ */
+struct async_msg {
+  async_msg() = default;
+
+  async_msg(async_msg_type type, const log_message &msg) { assign(type, msg); }
+
+  explicit async_msg(async_msg_type type, std::uint64_t flush_id = 0)
+      : type(type), flush_id(flush_id) {}
+
+  // 复用已有 buffer 容量,队列槽位反复赋值时不再分配
+  async_msg(const async_msg &other) { *this = other; }
+  async_msg &operator=(const async_msg &other) {
+    if (this != &other) {
+      copy_header_(other);
+      payload.clear();
+      payload.append(other.payload.data(),
+                     other.payload.data() + other.payload.size());
+    }
+    return *this;
+  }
+
+  async_msg(async_msg &&other) noexcept { *this = std::move(other); }
+  async_msg &operator=(async_msg &&other) noexcept {
+    if (this != &other) {
+      copy_header_(other);
+      payload = std::move(other.payload);
+    }
+    return *this;
+  }
+
+  /**
+   * @brief overwrite with msg, keeping the payload buffer and its capacity
+   *
+   * @param new_type
+   * @param msg
+   */
+  void assign(async_msg_type new_type, const log_message &msg) {
+    type = new_type;
+    level = msg.level;
+    time = msg.time;
+    loc = msg.loc;
+    thread_id = msg.thread_id;
+    flush_id = 0;
+    deferred = nullptr;
+    payload.clear();
+    payload.append(msg.payload.data(), msg.payload.data() + msg.payload.size());
+  }
+
+  /**
+   * @brief rebuild a log_message that views this payload
+   *
+   * @param logger_name
+   * @return log_message
+   */
+  log_message to_log_message(string_view_t logger_name) const {
+    log_message msg(logger_name, level, time, loc,
+                    string_view_t(payload.data(), payload.size()));
+    msg.thread_id = thread_id;
+    return msg;
+  }
+
+  async_msg_type type{async_msg_type::log};
+  mispdlog::level level{mispdlog::level::info};
+  log_clock::time_point time;
+  source_location loc;
+  size_t thread_id{0};
+  std::uint64_t flush_id{0};
+  // 非空表示 payload 是未格式化的参数记录,由它渲染成文本
+  const deferred_info *deferred{nullptr};
+  memory_buf_t payload;
+
+private:
+  void copy_header_(const async_msg &other) {
+    type = other.type;
+    level = other.level;
+    time = other.time;
+    loc = other.loc;
+    thread_id = other.thread_id;
+    flush_id = other.flush_id;
+    deferred = other.deferred;
+  }
+};
+} // namespace details
+} // namespace mispdlog
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "mispdlog/common.h"
+#include "mispdlog/details/async_msg.h"
+#include "mispdlog/details/log_message.h"
+#include "mispdlog/level.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief fixed-size ring of the latest messages a logger filtered out; slots
+ * are preallocated async_msg overwritten in place, so recording is one short
+ * critical section with a payload copy, no allocation for lines that fit the
+ * inline buffer, no pattern formatting, sink lock or I/O
+ *
+ */
+class MISPDLOG_API backtracer {
+public:
+  backtracer() = default;
+  backtracer(const backtracer &) = delete;
+  backtracer &operator=(const backtracer &) = delete;
+
+  /**
+   * @brief (re)allocate the ring, drops what was recorded so far
+   *
+   * @param size number of messages kept, 0 disables
+   * @param trigger messages at or above this level dump the ring first
+   */
+  void enable(size_t size, level trigger);
+  void disable();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  level trigger() const { return trigger_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief record msg, overwriting the oldest message when full
+   *
+   * @param msg
+   */
+  void push(const log_message &msg);
+
+  /**
+   * @brief call fn(const async_msg &) on the recorded messages, oldest
+   * first, under the ring lock, then empty the ring; the slots keep their
+   * buffers for the next push
+   *
+   * @param fn
+   */
+  template <typename Fn> void drain(Fn fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count_; i++) {
+      fn(static_cast<const async_msg &>(ring_[(head_ + i) % ring_.size()]));
+    }
+    head_ = 0;
+    count_ = 0;
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<async_msg> ring_;
+  size_t head_{0}; // 最旧消息的位置
+  size_t count_{0};
+  std::atomic<bool> enabled_{false};
+  std::atomic<level> trigger_{level::error};
+};
+} // namespace details
+} // namespace mispdlog
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "mispdlog/common.h"
+#include "mispdlog/details/log_message.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief layout of the binary log written by sinks::binary_file_sink:
+ * every session (file open) starts with magic, followed by chunks that each
+ * begin with a chunk tag byte:
+ *   name   : varint id, string name
+ *   site   : varint id, varint name id, string filename, varint line,
+ *            string function, string format, string signature
+ *   record : varint site id, level byte, zigzag varint nanoseconds since the
+ *            previous record, varint thread id, string body
+ * Strings are varint (length + 1) followed by the bytes, 0 means nullptr.
+ * The body of a site with a format string holds the packed arguments
+ * described by its signature (see deferred_info), otherwise the text payload.
+ *
+ */
+namespace binary {
+inline constexpr char magic[8] = {'M', 'I', 'S', 'P', 'B', 'I', 'N', '\x01'};
+
+enum class chunk : std::uint8_t {
+  session = 'M', // magic 的首字节
+  name = 'N',
+  site = 'S',
+  record = 'R'
+};
+
+inline void put_varint(std::uint64_t value, memory_buf_t &buf) {
+  while (value >= 0x80) {
+    buf.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buf.push_back(static_cast<char>(value));
+}
+
+inline std::uint64_t zigzag(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+
+inline void put_string(const char *data, size_t size, memory_buf_t &buf) {
+  if (data == nullptr) {
+    put_varint(0, buf);
+    return;
+  }
+  put_varint(size + 1, buf);
+  buf.append(data, data + size);
+}
+
+inline void put_c_string(const char *data, memory_buf_t &buf) {
+  put_string(data, data != nullptr ? std::strlen(data) : 0, buf);
+}
+
+/**
+ * @brief re-encode the arguments of a deferred record compactly: integers as
+ * (zigzag) varints, floating point as raw bytes, text as strings
+ *
+ * @param signature deferred_info::signature
+ * @param record the whole deferred record, header included
+ * @param out
+ */
+MISPDLOG_API void pack_args(const char *signature, string_view_t record,
+                            memory_buf_t &out);
+
+/**
+ * @brief render a format string with arguments packed by pack_args
+ *
+ * @param format
+ * @param signature
+ * @param args
+ * @param out
+ * @throw std::runtime_error when args does not match signature
+ */
+MISPDLOG_API void format_args(string_view_t format, const char *signature,
+                              string_view_t args, memory_buf_t &out);
+} // namespace binary
+
+/**
+ * @brief sequential reader of a binary log file, used by mispdlog-decode
+ *
+ */
+class MISPDLOG_API binary_reader {
+public:
+  /**
+   * @brief
+   *
+   * @param filename
+   * @throw std::runtime_error when the file cannot be opened or does not
+   * start with a session header
+   */
+  explicit binary_reader(const std::string &filename);
+
+  /**
+   * @brief read up to the next record; msg views strings owned by the
+   * reader and stays valid until the next call
+   *
+   * @param msg
+   * @return false at end of file
+   * @throw std::runtime_error on a truncated or corrupt file
+   */
+  bool next(log_message &msg);
+
+private:
+  struct site {
+    size_t name_id;
+    std::string filename;
+    std::string function;
+    std::string format;
+    std::string signature;
+    int line;
+    bool has_filename;
+    bool has_function;
+    bool has_format;
+  };
+
+  void read_session_();
+  std::uint8_t read_byte_();
+  std::uint64_t read_varint_();
+
+  /**
+   * @brief read a string chunk field into out
+   *
+   * @return false when the field was nullptr
+   */
+  bool read_string_(std::string &out);
+
+private:
+  std::ifstream file_;
+  std::vector<std::string> names_;
+  std::vector<site> sites_;
+  std::int64_t last_time_{0};
+  std::string body_;
+  memory_buf_t payload_;
+};
+} // namespace details
+} // namespace mispdlog
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "mispdlog/common.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief renders an encoded deferred record (format string + packed
+ * arguments) into text; one instantiation per argument type list
+ *
+ */
+using deferred_format_fn = void (*)(const char *data, size_t size,
+                                    memory_buf_t &out);
+
+/**
+ * @brief static description of one argument type list: the renderer and a
+ * '\0' terminated signature with one type tag per argument, which lets code
+ * that does not know the types (binary sink, decoder) walk the record
+ *
+ */
+struct deferred_info {
+  deferred_format_fn format;
+  const char *signature;
+};
+
+/**
+ * @brief type tag of an arithmetic argument: '?' bool, 'c' char, b/h/i/q
+ * signed and B/H/I/Q unsigned integers of 1/2/4/8 bytes, 'f' float, 'd'
+ * double, 'g' long double
+ *
+ */
+template <typename T> constexpr char arithmetic_tag() {
+  constexpr size_t index = sizeof(T) == 1   ? 0
+                           : sizeof(T) == 2 ? 1
+                           : sizeof(T) == 4 ? 2
+                                            : 3;
+  if constexpr (std::is_same_v<T, bool>) {
+    return '?';
+  } else if constexpr (std::is_same_v<T, char>) {
+    return 'c';
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return sizeof(T) == sizeof(float) ? 'f'
+           : sizeof(T) == sizeof(double) ? 'd'
+                                         : 'g';
+  } else if constexpr (std::is_signed_v<T>) {
+    return "bhiq"[index];
+  } else {
+    return "BHIQ"[index];
+  }
+}
+
+/**
+ * @brief how one argument type is packed into a deferred record; types
+ * without a specialization are not deferrable and are formatted eagerly
+ *
+ */
+template <typename T, typename = void> struct deferred_traits {
+  static constexpr bool value = false;
+};
+
+// 算术类型: 按字节拷贝
+template <typename T>
+struct deferred_traits<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+  static constexpr bool value = true;
+  static constexpr char tag = arithmetic_tag<T>();
+  using stored_type = T;
+
+  static void encode(T arg, memory_buf_t &buf) {
+    const char *bytes = reinterpret_cast<const char *>(&arg);
+    buf.append(bytes, bytes + sizeof(T));
+  }
+
+  static T decode(const char *&pos) {
+    T arg;
+    std::memcpy(&arg, pos, sizeof(T));
+    pos += sizeof(T);
+    return arg;
+  }
+};
+
+/**
+ * @brief text arguments ('z', 's') are copied with a length prefix; C
+ * strings keep a terminating '\0' so they decode back to const char*
+ * (nullptr stays nullptr) and format exactly like the eager path
+ *
+ */
+struct deferred_text {
+  static constexpr size_t null_length = static_cast<size_t>(-1);
+
+  static void encode(const char *data, size_t size, memory_buf_t &buf) {
+    const char *length = reinterpret_cast<const char *>(&size);
+    buf.append(length, length + sizeof(size));
+    if (size != null_length) {
+      buf.append(data, data + size);
+      buf.push_back('\0');
+    }
+  }
+
+  static const char *decode(const char *&pos, size_t &size) {
+    std::memcpy(&size, pos, sizeof(size));
+    pos += sizeof(size);
+    if (size == null_length) {
+      return nullptr;
+    }
+    const char *data = pos;
+    pos += size + 1;
+    return data;
+  }
+};
+
+template <> struct deferred_traits<const char *> {
+  static constexpr bool value = true;
+  static constexpr char tag = 'z'; // 可为 nullptr
+  using stored_type = const char *;
+
+  static void encode(const char *arg, memory_buf_t &buf) {
+    deferred_text::encode(arg, arg != nullptr ? std::strlen(arg)
+                                              : deferred_text::null_length,
+                          buf);
+  }
+
+  static const char *decode(const char *&pos) {
+    size_t size = 0;
+    return deferred_text::decode(pos, size);
+  }
+};
+
+template <> struct deferred_traits<char *> : deferred_traits<const char *> {};
+
+template <size_t N>
+struct deferred_traits<char[N]> : deferred_traits<const char *> {};
+
+template <size_t N>
+struct deferred_traits<const char[N]> : deferred_traits<const char *> {};
+
+template <> struct deferred_traits<std::string_view> {
+  static constexpr bool value = true;
+  static constexpr char tag = 's';
+  using stored_type = std::string_view;
+
+  static void encode(std::string_view arg, memory_buf_t &buf) {
+    deferred_text::encode(arg.data(), arg.size(), buf);
+  }
+
+  static std::string_view decode(const char *&pos) {
+    size_t size = 0;
+    const char *data = deferred_text::decode(pos, size);
+    return std::string_view(data, size);
+  }
+};
+
+// std::string 拷贝内容,解码为指向记录内部的视图
+template <>
+struct deferred_traits<std::string> : deferred_traits<std::string_view> {};
+
+template <typename... Args>
+inline constexpr bool is_deferrable_v =
+    (deferred_traits<std::remove_cv_t<std::remove_reference_t<Args>>>::value &&
+     ...);
+
+template <typename T>
+using deferred_traits_t =
+    deferred_traits<std::remove_cv_t<std::remove_reference_t<T>>>;
+
+/**
+ * @brief pack the format string and the arguments into buf; the format text
+ * is copied too, fmt::runtime() and std::string formats need not outlive the
+ * call
+ *
+ */
+template <typename... Args>
+inline void encode_deferred(fmt::string_view fmt, memory_buf_t &buf,
+                            const Args &...args) {
+  size_t size = fmt.size();
+  buf.append(reinterpret_cast<const char *>(&size),
+             reinterpret_cast<const char *>(&size) + sizeof(size));
+  buf.append(fmt.data(), fmt.data() + size);
+  (deferred_traits_t<Args>::encode(args, buf), ...);
+}
+
+// 记录头: 格式串长度 + 格式串内容,参数紧随其后
+inline fmt::string_view deferred_format_string(const char *data) {
+  size_t fmt_size = 0;
+  std::memcpy(&fmt_size, data, sizeof(fmt_size));
+  return fmt::string_view(data + sizeof(fmt_size), fmt_size);
+}
+
+inline size_t deferred_args_offset(const char *data) {
+  return sizeof(size_t) + deferred_format_string(data).size();
+}
+
+template <typename... Args>
+void format_deferred(const char *data, [[maybe_unused]] size_t size,
+                     memory_buf_t &out) {
+  [[maybe_unused]] const char *pos = data + deferred_args_offset(data);
+  // 花括号初始化保证按参数顺序从左到右解码
+  std::tuple<typename deferred_traits_t<Args>::stored_type...> decoded{
+      deferred_traits_t<Args>::decode(pos)...};
+  std::apply(
+      [&](const auto &...args) {
+        fmt::vformat_to(std::back_inserter(out), deferred_format_string(data),
+                        fmt::make_format_args(args...));
+      },
+      decoded);
+}
+
+template <typename... Args> struct deferred_signature {
+  static constexpr char value[] = {deferred_traits_t<Args>::tag..., '\0'};
+};
+
+/**
+ * @brief one static deferred_info per argument type list
+ *
+ */
+template <typename... Args>
+inline constexpr deferred_info deferred_info_v{
+    &format_deferred<Args...>, deferred_signature<Args...>::value};
+} // namespace details
+} // namespace mispdlog
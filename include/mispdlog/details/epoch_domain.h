@@ -0,0 +1,94 @@
+#pragma once
+
+#include "mispdlog/common.h"
+#include "mispdlog/details/mpsc_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief epoch based reclamation for objects read through raw pointers:
+ * - readers enter a guard, which publishes the epoch they started in
+ * - writers unlink an object, then retire() it with the current epoch
+ * - reclaim() destroys the retired objects no running guard can still see
+ * A thread outside any guard never blocks reclamation, whatever it cached.
+ *
+ */
+class MISPDLOG_API epoch_domain {
+public:
+  epoch_domain();
+
+  /**
+   * @brief destroys every retired object; no guard may be active
+   *
+   */
+  ~epoch_domain();
+
+  epoch_domain(const epoch_domain &) = delete;
+  epoch_domain &operator=(const epoch_domain &) = delete;
+
+  // 每个读线程一个槽位,线程退出后可被其他线程复用
+  struct alignas(cache_line_size) reader_slot {
+    std::atomic<std::uint64_t> epoch{0}; // 0 表示不在读
+    std::atomic<bool> in_use{true};
+    size_t depth{0}; // 嵌套的 guard 数,只由持有线程访问
+  };
+
+  /**
+   * @brief read side critical section, nestable; pointers loaded inside stay
+   * valid until the outermost guard of the thread ends
+   *
+   */
+  class MISPDLOG_API guard {
+  public:
+    explicit guard(epoch_domain &domain);
+    ~guard();
+
+    guard(const guard &) = delete;
+    guard &operator=(const guard &) = delete;
+
+  private:
+    reader_slot *slot_;
+  };
+
+  /**
+   * @brief hand over an object that readers can no longer reach through
+   * shared state; it is destroyed by a later reclaim()
+   *
+   * @param object
+   */
+  void retire(std::shared_ptr<const void> object);
+
+  /**
+   * @brief destroy the retired objects older than every running guard, on
+   * the calling thread and outside the internal lock
+   *
+   */
+  void reclaim();
+
+  /**
+   * @brief retired objects still waiting for running guards
+   *
+   * @return size_t
+   */
+  size_t retired_count() const;
+
+private:
+  reader_slot &local_slot_();
+
+private:
+  const std::uint64_t id_; // 线程本地表按 id 查找,地址可能被复用
+  std::atomic<std::uint64_t> epoch_{1};
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<reader_slot>> slots_;
+  std::vector<std::pair<std::uint64_t, std::shared_ptr<const void>>> retired_;
+};
+} // namespace details
+} // namespace mispdlog
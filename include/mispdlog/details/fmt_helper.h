@@ -0,0 +1,168 @@
+#pragma once
+
+#include "mispdlog/common.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fmt/format.h>
+#include <iterator>
+
+namespace mispdlog {
+namespace details {
+
+// "00" ~ "99", 每次查表输出两位数字
+inline constexpr char digits2_table[] = "00010203040506070809"
+                                        "10111213141516171819"
+                                        "20212223242526272829"
+                                        "30313233343536373839"
+                                        "40414243444546474849"
+                                        "50515253545556575859"
+                                        "60616263646566676869"
+                                        "70717273747576777879"
+                                        "80818283848586878889"
+                                        "90919293949596979899";
+
+/**
+ * @brief write n zero padded to exactly Width digits, two digits per step
+ * from the right; higher digits of n beyond Width are cut off
+ *
+ * @tparam Width
+ * @param n
+ * @param buf
+ */
+template <size_t Width>
+inline void pad_uint(std::uint64_t n, memory_buf_t &buf) {
+  static_assert(Width > 0 && Width <= 20, "pad_uint: width out of range");
+  char digits[Width];
+  size_t pos = Width;
+  while (pos >= 2) {
+    const char *pair = &digits2_table[(n % 100) * 2];
+    n /= 100;
+    digits[--pos] = pair[1];
+    digits[--pos] = pair[0];
+  }
+  if (pos == 1) {
+    digits[0] = static_cast<char>('0' + n % 10);
+  }
+  buf.append(digits, digits + Width);
+}
+
+/**
+ * @brief 2 digit field of std::tm, falls back to fmt for out of range values
+ *
+ * @param n
+ * @param buf
+ */
+inline void pad2(int n, memory_buf_t &buf) {
+  if (n >= 0 && n < 100) {
+    buf.append(&digits2_table[n * 2], &digits2_table[n * 2] + 2);
+  } else {
+    fmt::format_to(std::back_inserter(buf), "{:02d}", n);
+  }
+}
+
+/**
+ * @brief 4 digit year
+ *
+ * @param n
+ * @param buf
+ */
+inline void pad4(int n, memory_buf_t &buf) {
+  if (n >= 0 && n < 10000) {
+    pad_uint<4>(static_cast<std::uint64_t>(n), buf);
+  } else {
+    fmt::format_to(std::back_inserter(buf), "{:04d}", n);
+  }
+}
+
+/**
+ * @brief unpadded decimal, no format string parsing
+ *
+ * @param n
+ * @param buf
+ */
+inline void append_uint(std::uint64_t n, memory_buf_t &buf) {
+  char digits[20];
+  size_t pos = sizeof(digits);
+  while (n >= 100) {
+    const char *pair = &digits2_table[(n % 100) * 2];
+    n /= 100;
+    digits[--pos] = pair[1];
+    digits[--pos] = pair[0];
+  }
+  if (n >= 10) {
+    digits[--pos] = digits2_table[n * 2 + 1];
+    digits[--pos] = digits2_table[n * 2];
+  } else {
+    digits[--pos] = static_cast<char>('0' + n);
+  }
+  buf.append(digits + pos, digits + sizeof(digits));
+}
+
+/**
+ * @brief sub-second part of a time point in the given unit, e.g.
+ * time_fraction<std::chrono::milliseconds>(tp) is in [0, 1000)
+ *
+ * @tparam Unit
+ * @param tp
+ * @return std::uint64_t
+ */
+template <typename Unit>
+inline std::uint64_t time_fraction(const log_clock::time_point &tp) {
+  auto duration = tp.time_since_epoch();
+  auto secs = std::chrono::duration_cast<std::chrono::seconds>(duration);
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<Unit>(duration - secs).count());
+}
+
+/**
+ * @brief file name part of a path, e.g. "src/logger.cpp" -> "logger.cpp"
+ *
+ * @param path
+ * @return string_view_t
+ */
+constexpr string_view_t path_basename(const char *path) noexcept {
+  const char *base = path;
+  for (const char *p = path; *p != '\0'; p++) {
+#ifdef _WIN32
+    if (*p == '/' || *p == '\\') {
+#else
+    if (*p == '/') {
+#endif
+      base = p + 1;
+    }
+  }
+  return string_view_t(base);
+}
+
+/**
+ * @brief memoizes path_basename by pointer; every call site in a translation
+ * unit passes the same __FILE__ literal, so each path is scanned once instead
+ * of once per message. Not thread safe, owned by one formatter
+ *
+ */
+class basename_cache {
+public:
+  string_view_t get(const char *path) {
+    auto key = reinterpret_cast<std::uintptr_t>(path);
+    auto &slot = slots_[(key >> 4) % slot_count];
+    if (slot.path != path) {
+      slot.path = path;
+      slot.base = path_basename(path);
+    }
+    return slot.base;
+  }
+
+private:
+  static constexpr size_t slot_count = 16; // 直接映射,冲突时重新计算
+
+  struct slot {
+    const char *path{nullptr};
+    string_view_t base;
+  };
+  std::array<slot, slot_count> slots_{};
+};
+} // namespace details
+} // namespace mispdlog
@@ -8,6 +8,8 @@
 
 namespace mispdlog {
 namespace details {
+struct deferred_info;
+
 /**
  * @brief  loc
  *
@@ -27,7 +29,9 @@ struct source_location {
 };
 
 /**
- * @brief
+ * @brief logger_name and payload are non-owning views into the logger's name
+ * and the caller's format buffer, only valid during the log() call; anything
+ * that outlives the call (e.g. async queue) must take an owning copy
  *
  */
 struct log_message {
@@ -73,12 +77,15 @@ struct log_message {
   log_message(const log_message &) = default;
   log_message &operator=(const log_message &rhs) = default;
 
-  string_view_t logger_name;
-  string_view_t payload; // 日志内容
+  string_view_t logger_name; // 视图,指向 logger::name_
+  string_view_t payload;     // 日志内容,视图,指向调用方的 buffer
   mispdlog::level level{mispdlog::level::info};
   log_clock::time_point time; // timestamp
   source_location loc;
   size_t thread_id{0};
+  // 延迟格式化时指向原始参数记录,payload 仍是渲染后的文本
+  const deferred_info *deferred{nullptr};
+  string_view_t deferred_record;
 
   // 颜色范围(用于格式化时着色,由 formatter 设置)
   mutable size_t color_range_start{0};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace mispdlog {
+namespace details {
+
+// 避免 false sharing
+inline constexpr size_t cache_line_size = 64;
+
+/**
+ * @brief Bounded lock-free queue (Dmitry Vyukov's sequence-per-cell ring).
+ * Producers claim a slot with one CAS on the tail, the consumer claims with
+ * one CAS on the head, so an overrun_oldest producer may also evict the
+ * oldest element safely.
+ *
+ * @tparam T must be default constructible and assignable
+ */
+template <typename T> class mpsc_queue {
+public:
+  /**
+   * @brief Construct a new mpsc queue object
+   *
+   * @param capacity rounded up to the next power of two
+   */
+  explicit mpsc_queue(size_t capacity)
+      : capacity_(round_up_pow2_(capacity)), mask_(capacity_ - 1),
+        buffer_(std::make_unique<cell[]>(capacity_)) {
+    for (size_t i = 0; i < capacity_; i++) {
+      buffer_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpsc_queue(const mpsc_queue &) = delete;
+  mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+  /**
+   * @brief try to push one item, never blocks
+   *
+   * @return false when the queue is full
+   */
+  template <typename U> bool try_enqueue(U &&item) {
+    cell *target = nullptr;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      target = &buffer_[pos & mask_];
+      size_t seq = target->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    target->data = std::forward<U>(item);
+    target->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief push one item, spin then yield until there is room;
+   * a failed try_enqueue never touches item, so forwarding it again is safe
+   *
+   */
+  template <typename U> void enqueue(U &&item) {
+    for (size_t spins = 0; try_enqueue(std::forward<U>(item)) == false;
+         spins++) {
+      if (spins > 64) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /**
+   * @brief try to pop the oldest item
+   *
+   * @param item
+   * @return false when the queue is empty
+   */
+  bool try_dequeue(T &item) {
+    cell *target = nullptr;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      target = &buffer_[pos & mask_];
+      size_t seq = target->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    item = std::move(target->data);
+    target->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const noexcept { return capacity_; }
+
+  /**
+   * @brief approximate element count, only for statistics
+   *
+   */
+  size_t size_approx() const noexcept {
+    size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+    return tail >= head ? tail - head : 0;
+  }
+
+private:
+  struct cell {
+    std::atomic<size_t> sequence{0};
+    T data{};
+  };
+
+  static size_t round_up_pow2_(size_t n) {
+    size_t v = 2;
+    while (v < n) {
+      v <<= 1;
+    }
+    return v;
+  }
+
+private:
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<cell[]> buffer_;
+
+  alignas(cache_line_size) std::atomic<size_t> enqueue_pos_{0};
+  alignas(cache_line_size) std::atomic<size_t> dequeue_pos_{0};
+};
+} // namespace details
+} // namespace mispdlog
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "mispdlog/common.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief runs callback on its own thread every interval until destroyed; the
+ * destructor wakes the thread and joins it, so shutdown never waits for a
+ * full interval
+ *
+ */
+class MISPDLOG_API periodic_worker {
+public:
+  periodic_worker(std::function<void()> callback,
+                  std::chrono::milliseconds interval);
+  ~periodic_worker();
+
+  periodic_worker(const periodic_worker &) = delete;
+  periodic_worker &operator=(const periodic_worker &) = delete;
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_{false};
+  std::thread worker_;
+};
+} // namespace details
+} // namespace mispdlog
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "mispdlog/details/mpsc_queue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief Bounded single-producer single-consumer ring. Each side keeps its
+ * own index in a plain member and a cached copy of the other side's index,
+ * so a push is a slot assignment plus one release store, and the other
+ * side's atomic is only re-read when the cache says full / empty.
+ *
+ * @tparam T must be default constructible and assignable
+ */
+template <typename T> class spsc_queue {
+public:
+  /**
+   * @brief Construct a new spsc queue object
+   *
+   * @param capacity rounded up to the next power of two
+   */
+  explicit spsc_queue(size_t capacity)
+      : capacity_(round_up_pow2_(capacity)), mask_(capacity_ - 1),
+        buffer_(std::make_unique<T[]>(capacity_)) {}
+
+  spsc_queue(const spsc_queue &) = delete;
+  spsc_queue &operator=(const spsc_queue &) = delete;
+
+  /**
+   * @brief producer only: try to push one item, never blocks; a failed call
+   * does not touch item
+   *
+   * @return false when the queue is full
+   */
+  template <typename U> bool try_enqueue(U &&item) {
+    if (producer_.tail - producer_.head_cache == capacity_) {
+      producer_.head_cache = head_.load(std::memory_order_acquire);
+      if (producer_.tail - producer_.head_cache == capacity_) {
+        return false; // full
+      }
+    }
+    buffer_[producer_.tail & mask_] = std::forward<U>(item);
+    producer_.tail++;
+    tail_.store(producer_.tail, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief consumer only: the oldest item, left in place until pop()
+   *
+   * @return T* nullptr when the queue is empty
+   */
+  T *front() {
+    if (consumer_.head == consumer_.tail_cache) {
+      consumer_.tail_cache = tail_.load(std::memory_order_acquire);
+      if (consumer_.head == consumer_.tail_cache) {
+        return nullptr; // empty
+      }
+    }
+    return &buffer_[consumer_.head & mask_];
+  }
+
+  /**
+   * @brief consumer only: release the item returned by front()
+   *
+   */
+  void pop() {
+    consumer_.head++;
+    head_.store(consumer_.head, std::memory_order_release);
+  }
+
+  size_t capacity() const noexcept { return capacity_; }
+
+private:
+  static size_t round_up_pow2_(size_t n) {
+    size_t v = 2;
+    while (v < n) {
+      v <<= 1;
+    }
+    return v;
+  }
+
+private:
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<T[]> buffer_;
+
+  // 生产者独占的缓存行
+  struct alignas(cache_line_size) producer_side {
+    size_t tail{0};
+    size_t head_cache{0};
+  } producer_;
+  alignas(cache_line_size) std::atomic<size_t> tail_{0};
+
+  // 消费者独占的缓存行
+  struct alignas(cache_line_size) consumer_side {
+    size_t head{0};
+    size_t tail_cache{0};
+  } consumer_;
+  alignas(cache_line_size) std::atomic<size_t> head_{0};
+};
+} // namespace details
+} // namespace mispdlog
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "mispdlog/details/utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief per-thread xorshift64* generator, a few instructions per call and no
+ * shared state; not for anything but sampling
+ *
+ * @return std::uint64_t
+ */
+inline std::uint64_t fast_random() {
+  thread_local std::uint64_t state = [] {
+    // splitmix64 打散线程 id 和时间,保证种子非零且各线程不同
+    std::uint64_t seed =
+        static_cast<std::uint64_t>(get_thread_id()) ^
+        static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+    seed += 0x9e3779b97f4a7c15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+    seed ^= seed >> 31;
+    return seed != 0 ? seed : 1;
+  }();
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * @brief call site state of MISPDLOG_XXX_EVERY_N: the 1st, (n+1)th, ...
+ * call passes
+ *
+ */
+class every_n {
+public:
+  /**
+   * @brief
+   *
+   * @param n 0 is treated as 1
+   * @param suppressed calls dropped since the previous passing call
+   * @return true when this call should log
+   */
+  bool allow(std::uint64_t n, std::uint64_t &suppressed) {
+    std::uint64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (n <= 1) {
+      suppressed = 0;
+      return true;
+    }
+    if (count % n != 0) {
+      return false;
+    }
+    suppressed = count == 0 ? 0 : n - 1;
+    return true;
+  }
+
+private:
+  std::atomic<std::uint64_t> count_{0};
+};
+
+/**
+ * @brief call site state of MISPDLOG_XXX_EVERY_MS: at most one call passes
+ * per interval, the first one always does
+ *
+ */
+class every_ms {
+public:
+  bool allow(std::int64_t interval_ms, std::uint64_t &suppressed) {
+    std::int64_t now =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    std::int64_t next = next_.load(std::memory_order_relaxed);
+    // 只有抢到 CAS 的线程输出,其余计入丢弃数
+    if (now < next ||
+        next_.compare_exchange_strong(next, now + interval_ms * 1000000,
+                                      std::memory_order_relaxed) == false) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  std::atomic<std::int64_t> next_{0};
+  std::atomic<std::uint64_t> suppressed_{0};
+};
+
+/**
+ * @brief call site state of MISPDLOG_XXX_SAMPLED: each call passes with
+ * probability p, drawn from the calling thread's fast_random()
+ *
+ */
+class sampler {
+public:
+  bool allow(double p, std::uint64_t &suppressed) {
+    // 高 53 位映射到 [0, 1)
+    if (static_cast<double>(fast_random() >> 11) * 0x1.0p-53 >= p) {
+      suppressed_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  std::atomic<std::uint64_t> suppressed_{0};
+};
+} // namespace details
+} // namespace mispdlog
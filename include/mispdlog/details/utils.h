@@ -5,6 +5,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <ctime>
 #include <string>
 
 #ifdef _WIN32
@@ -32,12 +33,15 @@ inline constexpr char _k_level_ansi_colors[(std::uint8_t)level::off + 1][1] = {
 inline constexpr char _k_reset_ansi_color[1] = "";
 #endif
 
-MISPDLOG_API std::string color(level level, const string_view_t &msg);
+MISPDLOG_API std::string color(level level, string_view_t msg);
 
-// format time
+// 线程安全的 localtime
+MISPDLOG_API std::tm localtime(std::time_t time) noexcept;
+
+// format time, put_time 需要 '\0' 结尾的格式串
 MISPDLOG_API std::string
 format_time(const log_clock::time_point &tp,
-            string_view_t format = "%Y-%m-%d %H:%M:%S");
+            const std::string &format = "%Y-%m-%d %H:%M:%S");
 
 // 获取当前时间戳(毫秒)
 MISPDLOG_API uint64_t get_timestamp_ms();
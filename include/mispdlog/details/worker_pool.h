@@ -0,0 +1,76 @@
+#pragma once
+
+#include "mispdlog/common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief fixed set of threads, started on the first run() and reused until
+ * destroyed, that split a batch of indices with the calling thread; run()
+ * calls are serialized, one batch at a time
+ *
+ */
+class MISPDLOG_API worker_pool {
+public:
+  /**
+   * @brief
+   *
+   * @param threads extra threads besides the caller of run()
+   */
+  explicit worker_pool(size_t threads);
+  ~worker_pool();
+
+  worker_pool(const worker_pool &) = delete;
+  worker_pool &operator=(const worker_pool &) = delete;
+
+  /**
+   * @brief call fn(i) for every i in [0, count) on the pool and the calling
+   * thread, return when all calls are done. If the threads cannot be
+   * started the caller does the remaining work alone.
+   *
+   * @param count
+   * @param fn must not throw
+   */
+  void run(size_t count, const std::function<void(size_t)> &fn);
+
+  /**
+   * @brief threads started so far
+   *
+   * @return size_t
+   */
+  size_t thread_count() const;
+
+private:
+  void start_threads_();
+  void worker_loop_();
+  void work_();
+
+private:
+  const size_t max_threads_;
+  std::mutex run_mutex_; // 一次只执行一批
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::uint64_t batch_{0};
+  size_t pending_{0}; // 尚未处理完当前批次的线程数
+  bool stop_{false};
+  std::vector<std::thread> threads_;
+
+  // 当前批次,只在 run() 期间有效
+  const std::function<void(size_t)> *fn_{nullptr};
+  size_t count_{0};
+  std::atomic<size_t> next_{0};
+};
+} // namespace details
+} // namespace mispdlog
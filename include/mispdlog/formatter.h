@@ -21,8 +21,7 @@ public:
    * @param msg
    * @param buf
    */
-  virtual void format(const details::log_message &msg,
-                      fmt::memory_buffer &buf) = 0;
+  virtual void format(const details::log_message &msg, memory_buf_t &buf) = 0;
 
   /**
    * @brief Clone the formatter,to avoid multithreading issues
@@ -30,5 +29,14 @@ public:
    * @return std::unique_ptr<formatter>
    */
   virtual std::unique_ptr<formatter> clone() const = 0;
+
+  /**
+   * @brief Identity of the output layout, formatters with the same non-zero id
+   * render identical bytes, so a logger formats once and shares the result
+   * across those sinks; 0 means never shared
+   *
+   * @return size_t
+   */
+  virtual size_t pattern_id() const { return 0; }
 };
 } // namespace mispdlog
\ No newline at end of file
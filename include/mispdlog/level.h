@@ -4,6 +4,20 @@
 
 #include <cstdint>
 
+// 预处理器可比较的级别数值,与 enum class level 一一对应
+#define MISPDLOG_LEVEL_TRACE 0
+#define MISPDLOG_LEVEL_DEBUG 1
+#define MISPDLOG_LEVEL_INFO 2
+#define MISPDLOG_LEVEL_WARN 3
+#define MISPDLOG_LEVEL_ERROR 4
+#define MISPDLOG_LEVEL_CRITICAL 5
+#define MISPDLOG_LEVEL_OFF 6
+
+// 编译期最低级别,低于它的 MISPDLOG_XXX 宏展开为空,参数不会被求值
+#ifndef MISPDLOG_ACTIVE_LEVEL
+#define MISPDLOG_ACTIVE_LEVEL MISPDLOG_LEVEL_TRACE
+#endif
+
 namespace mispdlog {
 // 有宏展开的写法，见threadpool中的minilog
 enum class level : std::uint8_t {
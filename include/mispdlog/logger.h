@@ -1,13 +1,19 @@
 #pragma once
 
 #include "mispdlog/common.h"
+#include "mispdlog/details/async_msg.h"
+#include "mispdlog/details/backtracer.h"
+#include "mispdlog/details/deferred_args.h"
 #include "mispdlog/details/log_message.h"
 #include "mispdlog/level.h"
 #include "mispdlog/sinks/base_sink.h"
+#include <atomic>
+#include <cstdint>
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <iterator>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -39,11 +45,48 @@ public:
   level get_level() const;
   bool should_log(level message_level) const;
 
+  /**
+   * @brief should_log, or the message would still go to the backtrace ring
+   *
+   * @param message_level
+   * @return bool
+   */
+  bool should_record(level message_level) const;
+
   void flush();
   void flush_when(level level);
 
   const std::string &name() const;
 
+  /**
+   * @brief keep the last n messages filtered out by the logger level in a
+   * preallocated ring instead of dropping them; they are written through the
+   * sinks, oldest first, right before a message at or above trigger, or on
+   * dump_backtrace()
+   *
+   * @param n
+   * @param trigger
+   */
+  void enable_backtrace(size_t n, level trigger = level::error);
+  void disable_backtrace();
+
+  /**
+   * @brief write out and clear the recorded backtrace now
+   *
+   */
+  void dump_backtrace();
+
+  /**
+   * @brief deferred formatting: calls whose arguments are all arithmetic,
+   * C strings or std::string(_view) only copy the format string and the
+   * argument bytes into a record, the text is rendered later (on the backend
+   * thread of async_logger); other calls are still formatted eagerly.
+   *
+   * @param enabled
+   */
+  void set_deferred_format(bool enabled);
+  bool deferred_format() const;
+
 public:
   /**
    * @brief log output
@@ -55,16 +98,102 @@ public:
    */
   template <typename... Args>
   void log(level level, fmt::format_string<Args...> fmt, Args &&...args) {
-    if (should_log(level) == false) {
+    log(details::source_location{}, level, fmt, std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief log output with source location, used by the MISPDLOG_XXX macros
+   *
+   * @tparam Args
+   * @param loc
+   * @param level
+   * @param fmt
+   * @param args
+   */
+  template <typename... Args>
+  void log(details::source_location loc, level level,
+           fmt::format_string<Args...> fmt, Args &&...args) {
+    bool enabled = should_log(level);
+    if (enabled == false && tracer_.enabled() == false) {
       return;
     }
-    fmt::memory_buffer buf;
+    if constexpr (details::is_deferrable_v<Args...>) {
+      if (enabled && deferred_.load(std::memory_order_relaxed)) {
+        if (tracer_.enabled() && level >= tracer_.trigger()) {
+          dump_backtrace();
+        }
+        // 只拷贝参数字节,格式化推迟到 sink_deferred_ 的实现中
+        details::async_msg record;
+        record.level = level;
+        record.time = log_clock::now();
+        record.loc = loc;
+        record.thread_id = details::get_thread_id();
+        record.deferred =
+            &details::deferred_info_v<std::remove_reference_t<Args>...>;
+        details::encode_deferred(fmt::string_view(fmt), record.payload,
+                                 args...);
+        sink_deferred_(std::move(record));
+        return;
+      }
+    }
+    memory_buf_t buf;
     fmt::format_to(std::back_inserter(buf), fmt, std::forward<Args>(args)...);
     // log_message
-    details::log_message message(name_, level,
-                                 string_view_t(buf.data(), buf.size()));
-    // sink it
-    sink_it_(message);
+    log_it_(details::log_message(name_, level, loc,
+                                 string_view_t(buf.data(), buf.size())),
+            enabled);
+  }
+
+  /**
+   * @brief write msg as is: no format string parsing and no copy, the
+   * log_message views the caller's bytes ('{' and '}' are not special)
+   *
+   * @param loc
+   * @param level
+   * @param msg
+   */
+  void log_raw(details::source_location loc, level level, string_view_t msg) {
+    bool enabled = should_log(level);
+    if (enabled == false && tracer_.enabled() == false) {
+      return;
+    }
+    log_it_(details::log_message(name_, level, loc, msg), enabled);
+  }
+
+  void log_raw(level level, string_view_t msg) {
+    log_raw(details::source_location{}, level, msg);
+  }
+
+  /**
+   * @brief log() for the MISPDLOG_XXX_EVERY_N / _EVERY_MS / _SAMPLED macros:
+   * when calls were suppressed since the previous one, " [N suppressed]" is
+   * appended to the message (formatted eagerly even in deferred mode)
+   *
+   * @tparam Args
+   * @param loc
+   * @param level
+   * @param suppressed
+   * @param fmt
+   * @param args
+   */
+  template <typename... Args>
+  void log_throttled(details::source_location loc, level level,
+                     std::uint64_t suppressed, fmt::format_string<Args...> fmt,
+                     Args &&...args) {
+    if (suppressed == 0) {
+      log(loc, level, fmt, std::forward<Args>(args)...);
+      return;
+    }
+    bool enabled = should_log(level);
+    if (enabled == false && tracer_.enabled() == false) {
+      return;
+    }
+    memory_buf_t buf;
+    fmt::format_to(std::back_inserter(buf), fmt, std::forward<Args>(args)...);
+    fmt::format_to(std::back_inserter(buf), " [{} suppressed]", suppressed);
+    log_it_(details::log_message(name_, level, loc,
+                                 string_view_t(buf.data(), buf.size())),
+            enabled);
   }
 
   /**
@@ -76,7 +205,7 @@ public:
    */
   template <typename... Args>
   void trace(fmt::format_string<Args...> fmt, Args &&...args) {
-    log(level::trace, fmt, args...);
+    log(level::trace, fmt, std::forward<Args>(args)...);
   }
 
   /**
@@ -88,7 +217,7 @@ public:
    */
   template <typename... Args>
   void debug(fmt::format_string<Args...> fmt, Args &&...args) {
-    log(level::debug, fmt, args...);
+    log(level::debug, fmt, std::forward<Args>(args)...);
   }
 
   /**
@@ -100,7 +229,7 @@ public:
    */
   template <typename... Args>
   void info(fmt::format_string<Args...> fmt, Args &&...args) {
-    log(level::info, fmt, args...);
+    log(level::info, fmt, std::forward<Args>(args)...);
   }
 
   /**
@@ -112,7 +241,7 @@ public:
    */
   template <typename... Args>
   void warn(fmt::format_string<Args...> fmt, Args &&...args) {
-    log(level::warn, fmt, args...);
+    log(level::warn, fmt, std::forward<Args>(args)...);
   }
 
   /**
@@ -124,7 +253,7 @@ public:
    */
   template <typename... Args>
   void error(fmt::format_string<Args...> fmt, Args &&...args) {
-    log(level::error, fmt, args...);
+    log(level::error, fmt, std::forward<Args>(args)...);
   }
 
   /**
@@ -136,7 +265,7 @@ public:
    */
   template <typename... Args>
   void critical(fmt::format_string<Args...> fmt, Args &&...args) {
-    log(level::critical, fmt, args...);
+    log(level::critical, fmt, std::forward<Args>(args)...);
   }
 
   /**
@@ -148,10 +277,19 @@ public:
    */
   template <typename... Args>
   void off(fmt::format_string<Args...> fmt, Args &&...args) {
-    log(level::off, fmt, args...);
+    log(level::off, fmt, std::forward<Args>(args)...);
   }
 
 protected:
+  /**
+   * @brief route a formatted message: filtered ones only go to the
+   * backtrace ring, others may trigger a backtrace dump and then sink_it_
+   *
+   * @param message
+   * @param enabled should_log(message.level)
+   */
+  void log_it_(const details::log_message &message, bool enabled);
+
   /**
    * @brief through sink to real output
    *
@@ -159,10 +297,47 @@ protected:
    */
   virtual void sink_it_(const details::log_message &message);
 
+  /**
+   * @brief flush all sinks, async_logger routes it through its queue
+   *
+   */
+  virtual void flush_();
+
+  /**
+   * @brief take a deferred record (see set_deferred_format); the default
+   * renders it right away and passes it to sink_it_, async_logger enqueues it
+   * and renders on the backend thread
+   *
+   * @param record
+   */
+  virtual void sink_deferred_(details::async_msg &&record);
+
+  /**
+   * @brief hand message to every sink that accepts it; sinks whose formatters
+   * share a pattern_id get one rendering instead of formatting N times
+   *
+   * @param message
+   */
+  void fan_out_(const details::log_message &message);
+
+  /**
+   * @brief log_message of a deferred record, viewing the raw record; the
+   * text is rendered into buf only if some sink needs_payload()
+   *
+   * @param record
+   * @param buf
+   * @return details::log_message
+   */
+  details::log_message deferred_message_(const details::async_msg &record,
+                                         memory_buf_t &buf) const;
+
 protected:
   std::string name_;
   std::vector<sinks::sink_ptr> sinks_;
-  level level_{level::trace};
-  level flush_level_{level::off}; // 自动刷新日志等级
+  // 原子变量: 管理线程修改级别时,日志线程的 relaxed 读取无需加锁
+  std::atomic<level> level_{level::trace};
+  std::atomic<level> flush_level_{level::off}; // 自动刷新日志等级
+  details::backtracer tracer_;
+  std::atomic<bool> deferred_{false};
 };
 } // namespace mispdlog
\ No newline at end of file
@@ -1,15 +1,21 @@
 #pragma once
 
+#include "mispdlog/async_logger.h"
+#include "mispdlog/details/throttle.h"
 #include "mispdlog/level.h"
 #include "mispdlog/logger.h"
 #include "mispdlog/registry.h"
+#include "mispdlog/sinks/binary_file_sink.h"
 #include "mispdlog/sinks/color_console_sink.h"
 #include "mispdlog/sinks/console_sink.h"
+#include "mispdlog/sinks/dup_filter_sink.h"
 #include "mispdlog/sinks/file_sink.h"
 #include "mispdlog/sinks/rotating_file_sink.h"
+#include <chrono>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 /**
 ┌─────────────────────────────────────────────────────────────────┐
@@ -54,10 +60,20 @@
  */
 
 namespace mispdlog {
-inline std::shared_ptr<logger> get_logger(const std::string &name) {
+inline std::shared_ptr<logger> get_logger(string_view_t name) {
   return registry::instance().get(name);
 }
 
+/**
+ * @brief get_logger without refcount traffic, see registry::get_raw
+ *
+ * @param name
+ * @return logger*
+ */
+inline logger *get_logger_raw(string_view_t name) {
+  return registry::instance().get_raw(name);
+}
+
 /**
  * @brief throw throw std::runtime_error when logger exists.
  *
@@ -75,6 +91,26 @@ inline std::shared_ptr<logger> default_logger() {
   return registry::instance().default_logger();
 }
 
+/**
+ * @brief default logger without lock or refcount traffic, see
+ * registry::default_logger_raw
+ *
+ * @return logger*
+ */
+inline logger *default_logger_raw() {
+  return registry::instance().default_logger_raw();
+}
+
+/**
+ * @brief default logger held for one call, safe against a concurrent
+ * set_default_logger()/drop()
+ *
+ * @return registry::pinned_logger
+ */
+inline registry::pinned_logger pinned_default_logger() {
+  return registry::instance().pin_default_logger();
+}
+
 inline void set_default_logger(std::shared_ptr<logger> new_defauly_logger) {
   registry::instance().set_default_logger(new_defauly_logger);
 }
@@ -83,7 +119,43 @@ inline void set_all_level(level level) {
   registry::instance().set_all_level(level);
 }
 
-inline void flush_all_loggers() { registry::instance().flush_all_loggers(); }
+/**
+ * @brief hierarchical level, e.g. set_level("net.*", level::debug), see
+ * registry::set_level
+ *
+ * @param pattern
+ * @param level
+ */
+inline void set_level(const std::string &pattern, level level) {
+  registry::instance().set_level(pattern, level);
+}
+
+/**
+ * @brief set the level of loggers matching a glob, e.g. "tenant.42.*"
+ *
+ * @param glob
+ * @param level
+ */
+inline void set_level_matching(string_view_t glob, level level) {
+  registry::instance().set_level_matching(glob, level);
+}
+
+inline std::vector<flush_result> flush_matching(string_view_t glob) {
+  return registry::instance().flush_matching(glob);
+}
+
+inline std::vector<flush_result> flush_all_loggers() {
+  return registry::instance().flush_all_loggers();
+}
+
+/**
+ * @brief flush every registered logger periodically on a background thread
+ *
+ * @param interval
+ */
+inline void flush_every(std::chrono::milliseconds interval) {
+  registry::instance().flush_every(interval);
+}
 
 /**
  * @brief make color_console_sink_mt
@@ -160,39 +232,273 @@ rotating_logger_mt(const std::string &logger_name, const std::string &path,
   return new_logger;
 }
 
+/**
+ * @brief make sinks::binary_file_sink_mt behind an async_logger with
+ * deferred formatting, so producers only copy arguments; decode the file with
+ * mispdlog-decode
+ *
+ * @param logger_name
+ * @param path
+ * @param truncate
+ * @param queue_size
+ * @param policy
+ * @return std::shared_ptr<logger>
+ */
+inline std::shared_ptr<logger> async_binary_logger_mt(
+    const std::string &logger_name, const std::string &path,
+    bool truncate = false,
+    size_t queue_size = async_logger::default_queue_size,
+    async_overflow_policy policy = async_overflow_policy::block) {
+  auto sink = std::make_shared<sinks::binary_file_sink_mt>(path, truncate);
+  auto new_logger =
+      std::make_shared<async_logger>(logger_name, sink, queue_size, policy);
+  new_logger->set_deferred_format(true);
+  register_logger(new_logger);
+  return new_logger;
+}
+
+/**
+ * @brief make sinks::file_sink_mt behind an async_logger
+ *
+ * @param logger_name
+ * @param path
+ * @param truncate
+ * @param queue_size
+ * @param policy
+ * @return std::shared_ptr<logger>
+ */
+inline std::shared_ptr<logger> async_basic_logger_mt(
+    const std::string &logger_name, const std::string &path,
+    bool truncate = false,
+    size_t queue_size = async_logger::default_queue_size,
+    async_overflow_policy policy = async_overflow_policy::block) {
+  auto sink = std::make_shared<sinks::file_sink_mt>(path, truncate);
+  auto new_logger =
+      std::make_shared<async_logger>(logger_name, sink, queue_size, policy);
+  register_logger(new_logger);
+  return new_logger;
+}
+
+/**
+ * @brief make sinks::rotating_file_sink_mt behind an async_logger
+ *
+ * @param logger_name
+ * @param path
+ * @param max_size
+ * @param max_files
+ * @param queue_size
+ * @param policy
+ * @return std::shared_ptr<logger>
+ */
+inline std::shared_ptr<logger> async_rotating_logger_mt(
+    const std::string &logger_name, const std::string &path, size_t max_size,
+    size_t max_files, size_t queue_size = async_logger::default_queue_size,
+    async_overflow_policy policy = async_overflow_policy::block) {
+  auto sink =
+      std::make_shared<sinks::rotating_file_sink_mt>(path, max_size, max_files);
+  auto new_logger =
+      std::make_shared<async_logger>(logger_name, sink, queue_size, policy);
+  register_logger(new_logger);
+  return new_logger;
+}
+
 // fast use
+/**
+ * @brief write msg through the default logger as is, see logger::log_raw
+ *
+ * @param level
+ * @param msg
+ */
+inline void log_raw(level level, string_view_t msg) {
+  pinned_default_logger()->log_raw(level, msg);
+}
+
 template <typename... Args>
 inline void trace(fmt::format_string<Args...> fmt, Args &&...args) {
-  default_logger()->trace(fmt, std::forward<Args>(args)...);
+  pinned_default_logger()->trace(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 inline void debug(fmt::format_string<Args...> fmt, Args &&...args) {
-  default_logger()->debug(fmt, std::forward<Args>(args)...);
+  pinned_default_logger()->debug(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 inline void info(fmt::format_string<Args...> fmt, Args &&...args) {
-  default_logger()->info(fmt, std::forward<Args>(args)...);
+  pinned_default_logger()->info(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 inline void warn(fmt::format_string<Args...> fmt, Args &&...args) {
-  default_logger()->warn(fmt, std::forward<Args>(args)...);
+  pinned_default_logger()->warn(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 inline void error(fmt::format_string<Args...> fmt, Args &&...args) {
-  default_logger()->error(fmt, std::forward<Args>(args)...);
+  pinned_default_logger()->error(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 inline void critical(fmt::format_string<Args...> fmt, Args &&...args) {
-  default_logger()->critical(fmt, std::forward<Args>(args)...);
+  pinned_default_logger()->critical(fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 inline void off(fmt::format_string<Args...> fmt, Args &&...args) {
-  default_logger()->off(fmt, std::forward<Args>(args)...);
+  pinned_default_logger()->off(fmt, std::forward<Args>(args)...);
 }
-} // namespace mispdlog
\ No newline at end of file
+
+} // namespace mispdlog
+
+// 源码位置宏: __FILE__/__LINE__/__func__ 在编译期确定,构造 source_location
+// 无运行期开销
+#define MISPDLOG_LOGGER_CALL(logger, level, ...)                               \
+  (logger)->log(mispdlog::details::source_location{__FILE__, __LINE__,         \
+                                                   __func__},                  \
+                level, __VA_ARGS__)
+
+/**
+ * @brief MISPDLOG_LOGGER_CALL behind a static throttle per call site (see
+ * details/throttle.h): a suppressed call costs a level check and one atomic
+ * operation, never formats, and the number of suppressed calls is appended
+ * to the next line that passes; below the logger level it still counts and
+ * records into the backtrace ring when that is enabled; logger is evaluated
+ * once, a temporary shared_ptr (e.g. mispdlog::get("x")) lives until the end
+ * of the call
+ *
+ */
+#define MISPDLOG_LOGGER_CALL_THROTTLED(logger, level, throttle, limit, ...)    \
+  do {                                                                         \
+    static throttle mispdlog_throttle_;                                        \
+    auto &&mispdlog_logger_ = (logger);                                        \
+    std::uint64_t mispdlog_suppressed_ = 0;                                    \
+    if (mispdlog_logger_->should_record(level) &&                              \
+        mispdlog_throttle_.allow(limit, mispdlog_suppressed_)) {               \
+      mispdlog_logger_->log_throttled(                                         \
+          mispdlog::details::source_location{__FILE__, __LINE__, __func__},    \
+          level, mispdlog_suppressed_, __VA_ARGS__);                           \
+    }                                                                          \
+  } while (0)
+
+/**
+ * @brief MISPDLOG_TRACE(logger, fmt, args...) ... MISPDLOG_CRITICAL; levels
+ * below MISPDLOG_ACTIVE_LEVEL expand to (void)0 so their arguments are never
+ * evaluated, e.g. add_definitions(-DMISPDLOG_ACTIVE_LEVEL=MISPDLOG_LEVEL_INFO)
+ * MISPDLOG_XXX_EVERY_N(logger, n, ...) logs the 1st, (n+1)th, ... call,
+ * MISPDLOG_XXX_EVERY_MS(logger, ms, ...) at most one call per ms interval and
+ * MISPDLOG_XXX_SAMPLED(logger, p, ...) each call with probability p
+ *
+ */
+#if MISPDLOG_ACTIVE_LEVEL <= MISPDLOG_LEVEL_TRACE
+#define MISPDLOG_TRACE(logger, ...)                                            \
+  MISPDLOG_LOGGER_CALL(logger, mispdlog::level::trace, __VA_ARGS__)
+#define MISPDLOG_TRACE_EVERY_N(logger, n, ...)                                 \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::trace,               \
+                                 mispdlog::details::every_n, n, __VA_ARGS__)
+#define MISPDLOG_TRACE_EVERY_MS(logger, ms, ...)                               \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::trace,               \
+                                 mispdlog::details::every_ms, ms, __VA_ARGS__)
+#define MISPDLOG_TRACE_SAMPLED(logger, p, ...)                                 \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::trace,               \
+                                 mispdlog::details::sampler, p, __VA_ARGS__)
+#else
+#define MISPDLOG_TRACE(logger, ...) (void)0
+#define MISPDLOG_TRACE_EVERY_N(logger, n, ...) (void)0
+#define MISPDLOG_TRACE_EVERY_MS(logger, ms, ...) (void)0
+#define MISPDLOG_TRACE_SAMPLED(logger, p, ...) (void)0
+#endif
+
+#if MISPDLOG_ACTIVE_LEVEL <= MISPDLOG_LEVEL_DEBUG
+#define MISPDLOG_DEBUG(logger, ...)                                            \
+  MISPDLOG_LOGGER_CALL(logger, mispdlog::level::debug, __VA_ARGS__)
+#define MISPDLOG_DEBUG_EVERY_N(logger, n, ...)                                 \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::debug,               \
+                                 mispdlog::details::every_n, n, __VA_ARGS__)
+#define MISPDLOG_DEBUG_EVERY_MS(logger, ms, ...)                               \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::debug,               \
+                                 mispdlog::details::every_ms, ms, __VA_ARGS__)
+#define MISPDLOG_DEBUG_SAMPLED(logger, p, ...)                                 \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::debug,               \
+                                 mispdlog::details::sampler, p, __VA_ARGS__)
+#else
+#define MISPDLOG_DEBUG(logger, ...) (void)0
+#define MISPDLOG_DEBUG_EVERY_N(logger, n, ...) (void)0
+#define MISPDLOG_DEBUG_EVERY_MS(logger, ms, ...) (void)0
+#define MISPDLOG_DEBUG_SAMPLED(logger, p, ...) (void)0
+#endif
+
+#if MISPDLOG_ACTIVE_LEVEL <= MISPDLOG_LEVEL_INFO
+#define MISPDLOG_INFO(logger, ...)                                             \
+  MISPDLOG_LOGGER_CALL(logger, mispdlog::level::info, __VA_ARGS__)
+#define MISPDLOG_INFO_EVERY_N(logger, n, ...)                                  \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::info,                \
+                                 mispdlog::details::every_n, n, __VA_ARGS__)
+#define MISPDLOG_INFO_EVERY_MS(logger, ms, ...)                                \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::info,                \
+                                 mispdlog::details::every_ms, ms, __VA_ARGS__)
+#define MISPDLOG_INFO_SAMPLED(logger, p, ...)                                  \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::info,                \
+                                 mispdlog::details::sampler, p, __VA_ARGS__)
+#else
+#define MISPDLOG_INFO(logger, ...) (void)0
+#define MISPDLOG_INFO_EVERY_N(logger, n, ...) (void)0
+#define MISPDLOG_INFO_EVERY_MS(logger, ms, ...) (void)0
+#define MISPDLOG_INFO_SAMPLED(logger, p, ...) (void)0
+#endif
+
+#if MISPDLOG_ACTIVE_LEVEL <= MISPDLOG_LEVEL_WARN
+#define MISPDLOG_WARN(logger, ...)                                             \
+  MISPDLOG_LOGGER_CALL(logger, mispdlog::level::warn, __VA_ARGS__)
+#define MISPDLOG_WARN_EVERY_N(logger, n, ...)                                  \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::warn,                \
+                                 mispdlog::details::every_n, n, __VA_ARGS__)
+#define MISPDLOG_WARN_EVERY_MS(logger, ms, ...)                                \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::warn,                \
+                                 mispdlog::details::every_ms, ms, __VA_ARGS__)
+#define MISPDLOG_WARN_SAMPLED(logger, p, ...)                                  \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::warn,                \
+                                 mispdlog::details::sampler, p, __VA_ARGS__)
+#else
+#define MISPDLOG_WARN(logger, ...) (void)0
+#define MISPDLOG_WARN_EVERY_N(logger, n, ...) (void)0
+#define MISPDLOG_WARN_EVERY_MS(logger, ms, ...) (void)0
+#define MISPDLOG_WARN_SAMPLED(logger, p, ...) (void)0
+#endif
+
+#if MISPDLOG_ACTIVE_LEVEL <= MISPDLOG_LEVEL_ERROR
+#define MISPDLOG_ERROR(logger, ...)                                            \
+  MISPDLOG_LOGGER_CALL(logger, mispdlog::level::error, __VA_ARGS__)
+#define MISPDLOG_ERROR_EVERY_N(logger, n, ...)                                 \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::error,               \
+                                 mispdlog::details::every_n, n, __VA_ARGS__)
+#define MISPDLOG_ERROR_EVERY_MS(logger, ms, ...)                               \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::error,               \
+                                 mispdlog::details::every_ms, ms, __VA_ARGS__)
+#define MISPDLOG_ERROR_SAMPLED(logger, p, ...)                                 \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::error,               \
+                                 mispdlog::details::sampler, p, __VA_ARGS__)
+#else
+#define MISPDLOG_ERROR(logger, ...) (void)0
+#define MISPDLOG_ERROR_EVERY_N(logger, n, ...) (void)0
+#define MISPDLOG_ERROR_EVERY_MS(logger, ms, ...) (void)0
+#define MISPDLOG_ERROR_SAMPLED(logger, p, ...) (void)0
+#endif
+
+#if MISPDLOG_ACTIVE_LEVEL <= MISPDLOG_LEVEL_CRITICAL
+#define MISPDLOG_CRITICAL(logger, ...)                                         \
+  MISPDLOG_LOGGER_CALL(logger, mispdlog::level::critical, __VA_ARGS__)
+#define MISPDLOG_CRITICAL_EVERY_N(logger, n, ...)                              \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::critical,            \
+                                 mispdlog::details::every_n, n, __VA_ARGS__)
+#define MISPDLOG_CRITICAL_EVERY_MS(logger, ms, ...)                            \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::critical,            \
+                                 mispdlog::details::every_ms, ms, __VA_ARGS__)
+#define MISPDLOG_CRITICAL_SAMPLED(logger, p, ...)                              \
+  MISPDLOG_LOGGER_CALL_THROTTLED(logger, mispdlog::level::critical,            \
+                                 mispdlog::details::sampler, p, __VA_ARGS__)
+#else
+#define MISPDLOG_CRITICAL(logger, ...) (void)0
+#define MISPDLOG_CRITICAL_EVERY_N(logger, n, ...) (void)0
+#define MISPDLOG_CRITICAL_EVERY_MS(logger, ms, ...) (void)0
+#define MISPDLOG_CRITICAL_SAMPLED(logger, p, ...) (void)0
+#endif
@@ -5,9 +5,59 @@
 #include <chrono>
 #include <ctime>
 #include <fmt/format.h>
+#include <string>
+#include <typeindex>
 #include <vector>
 namespace mispdlog {
 
+// 默认格式, constexpr 数组可直接作为 static_pattern_formatter 的模板参数
+inline constexpr char default_pattern[] = "[%Y-%m-%d %H:%M:%S][%L]%v";
+
+namespace details {
+/**
+ * @brief map a formatter type and pattern string to a process-wide unique id,
+ * so formatters of the same type with equal patterns can share rendered
+ * output
+ *
+ * @param type
+ * @param pattern
+ * @return size_t never 0
+ */
+MISPDLOG_API size_t intern_pattern(std::type_index type,
+                                   const std::string &pattern);
+
+constexpr bool is_pattern_flag(char c) noexcept {
+  switch (c) {
+  case 'Y':
+  case 'm':
+  case 'd':
+  case 'H':
+  case 'M':
+  case 'S':
+  case 'e':
+  case 'f':
+  case 'F':
+  case 'l':
+  case 'L':
+  case 'n':
+  case 'v':
+  case 't':
+  case 's':
+  case '#':
+  case '!':
+  case '@':
+    return true;
+  default:
+    return false;
+  }
+}
+
+// 只包含整秒精度的时间占位符,同一秒内输出不变,可以缓存
+constexpr bool is_time_flag(char c) noexcept {
+  return c == 'Y' || c == 'm' || c == 'd' || c == 'H' || c == 'M' || c == 'S';
+}
+} // namespace details
+
 class pattern_formatter : public formatter {
 public:
   /**
@@ -15,8 +65,7 @@ public:
    *
    * @param pattern
    */
-  explicit pattern_formatter(
-      const std::string &pattern = "[%Y-%m-%d %H:%M:%S][%L]%v");
+  explicit pattern_formatter(const std::string &pattern = default_pattern);
 
   ~pattern_formatter() override = default;
 
@@ -24,14 +73,25 @@ public:
    * @brief Format the log message according to the pattern;
    * Pattern: [%Y-%m-%d %H:%M:%S] [%l] %v ;
    * Output:  [2025-09-30 03:36:39] [I] Hello, World!
+   * Sub-second flags: %e milliseconds, %f microseconds, %F nanoseconds
+   * Source flags: %s file basename, %# line, %! function, %@ basename:line,
+   * empty when the call site did not record a source location
    * @param msg
    * @param buf
    */
-  void format(const details::log_message &msg,
-              fmt::memory_buffer &buf) override;
+  void format(const details::log_message &msg, memory_buf_t &buf) override;
 
   std::unique_ptr<formatter> clone() const override;
 
+  /**
+   * @brief interned id of the dynamic type and pattern string: equal
+   * patterns share one id, a subclass that may render differently gets its
+   * own
+   *
+   * @return size_t
+   */
+  size_t pattern_id() const override;
+
   /**
    * @brief Set the pattern object
    *
@@ -58,7 +118,7 @@ public:
      * @param buf
      */
     virtual void format(const details::log_message &msg, const std::tm &tm,
-                        fmt::memory_buffer &buf) = 0;
+                        memory_buf_t &buf) = 0;
 
     /**
      * @brief Clone the flag formatter
@@ -71,10 +131,18 @@ public:
 private:
   void compile_pattern();
 
+  /**
+   * @brief merge each run of time flags into one cached_time_formatter
+   *
+   * @param flags flag char of every formatter, 0 for raw text
+   */
+  void group_time_runs(const std::vector<char> &flags);
+
   std::tm get_time(const details::log_message &msg) const;
 
 private:
   std::string pattern_;
+  size_t pattern_id_{0};
   std::vector<std::unique_ptr<flag_formatter>> formatters_;
 
   // 缓存上次格式化的时间，优化时间格式化性能
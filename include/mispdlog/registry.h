@@ -1,13 +1,34 @@
 #pragma once
 #include "mispdlog/common.h"
+#include "mispdlog/details/epoch_domain.h"
+#include "mispdlog/details/periodic_worker.h"
+#include "mispdlog/details/worker_pool.h"
 #include "mispdlog/level.h"
 #include "mispdlog/logger.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace mispdlog {
+/**
+ * @brief outcome of flushing one sink in registry::flush_all_loggers
+ *
+ */
+struct flush_result {
+  std::string logger_name; // 共享 sink 时为第一个引用它的 logger
+  sinks::sink_ptr sink;    // 为空表示经由 async_logger 队列刷新其全部 sink
+  std::chrono::microseconds latency{0};
+  std::string error; // 为空表示成功
+};
+
 class MISPDLOG_API registry {
 public:
   registry(const registry &) = delete;
@@ -25,30 +46,262 @@ public:
    * @param logger
    */
   void register_logger(std::shared_ptr<logger> logger);
-  std::shared_ptr<logger> get(const std::string &logger_name);
+
+  /**
+   * @brief lock-free lookup in the calling thread's snapshot, a string_view
+   * or literal name does not allocate
+   *
+   * @param logger_name
+   * @return std::shared_ptr<logger> nullptr if not found
+   */
+  std::shared_ptr<logger> get(string_view_t logger_name);
+
+  /**
+   * @brief get() without the refcount increment; the pointer stays valid
+   * while the logger is registered, drop() may destroy it right away
+   *
+   * @param logger_name
+   * @return logger* nullptr if not found
+   */
+  logger *get_raw(string_view_t logger_name);
 
   void drop(const std::string &logger_name);
   void drop_all();
 
+  /**
+   * @brief the default color console logger is built on first use here or
+   * in default_logger_raw(), and again after drop/drop_all removed it
+   *
+   * @return std::shared_ptr<logger>
+   */
   std::shared_ptr<logger> default_logger();
+
+  /**
+   * @brief lock-free fast path of default_logger(); each thread caches the
+   * raw pointer and only refreshes it (under the mutex) when the default
+   * logger was replaced. The pointer stays valid until the default logger
+   * is replaced or dropped, use pin_default_logger() when that may race.
+   *
+   * @return logger*
+   */
+  logger *default_logger_raw();
+
+  /**
+   * @brief the default logger, kept alive for the holder's lifetime by an
+   * epoch guard instead of a refcount; replacing it meanwhile only defers
+   * its destruction. Keep it on the stack for one call.
+   *
+   */
+  class MISPDLOG_API pinned_logger {
+  public:
+    explicit pinned_logger(registry &owner);
+
+    logger *operator->() const { return logger_; }
+    logger &operator*() const { return *logger_; }
+
+  private:
+    details::epoch_domain::guard guard_;
+    logger *logger_;
+  };
+
+  pinned_logger pin_default_logger() { return pinned_logger(*this); }
+
   void set_default_logger(std::shared_ptr<logger> new_default_logger);
 
 public:
+  static constexpr size_t flush_pool_size = 4;
+
+  /**
+   * @brief set every logger, the default one included, to level and clear
+   * the set_level rules, so loggers registered later keep their own level
+   *
+   * @param level
+   */
   void set_all_level(level level);
-  void flush_all_loggers();
+
+  /**
+   * @brief level for a dot separated name hierarchy: "net.*" covers "net"
+   * and every "net.xxx" below it, a plain name covers only that logger and
+   * "*" covers all. The most specific rule wins, e.g. "net.http.*" over
+   * "net.*". The result is stored in each logger's level, so should_log
+   * stays a single compare; loggers registered later get it on
+   * registration. Rules are cleared by drop_all.
+   *
+   * @param pattern
+   * @param level
+   * @throw std::invalid_argument when '*' is not a trailing ".*" or "*"
+   */
+  void set_level(const std::string &pattern, level level);
+
+  /**
+   * @brief set the level of every logger whose name matches glob ('*' and
+   * '?'); only the range of the sorted name index that shares the glob's
+   * literal prefix is visited, so "tenant.42.*" stays cheap with 100k
+   * loggers. Unlike set_level this is not remembered for later loggers.
+   *
+   * @param glob
+   * @param level
+   */
+  void set_level_matching(string_view_t glob, level level);
+
+  /**
+   * @brief flush_all_loggers restricted to the loggers matching glob
+   *
+   * @param glob
+   * @return std::vector<flush_result>
+   */
+  std::vector<flush_result> flush_matching(string_view_t glob);
+
+  /**
+   * @brief flush every sink once: the unique sinks are collected under the
+   * lock, then flushed concurrently by the calling thread and the registry's
+   * flush_pool_size - 1 resident threads with the lock released; async
+   * loggers are flushed through their queue
+   *
+   * @return std::vector<flush_result> one entry per flushed sink
+   */
+  std::vector<flush_result> flush_all_loggers();
+
+  /**
+   * @brief start one background thread that flushes every registered logger
+   * each interval, replacing any previous one; the registry lock is only held
+   * to take a snapshot, never during I/O. interval <= 0 stops it, drop_all
+   * stops it as well.
+   *
+   * @param interval
+   */
+  void flush_every(std::chrono::milliseconds interval);
 
 private:
+  /**
+   * @brief one shard, entries sorted by name in a flat vector: the
+   * copy-on-write clone is one allocation plus refcount increments instead
+   * of a node allocation and rehash per entry
+   *
+   */
+  class logger_map {
+  public:
+    struct entry {
+      string_view_t name; // logger::name() 的视图,与 logger 同生命周期
+      std::shared_ptr<mispdlog::logger> value;
+    };
+
+    const entry *find(string_view_t name) const;
+    void insert_or_assign(std::shared_ptr<logger> new_logger);
+    void erase(string_view_t name);
+
+    std::vector<entry>::const_iterator begin() const {
+      return entries_.begin();
+    }
+    std::vector<entry>::const_iterator end() const { return entries_.end(); }
+
+  private:
+    std::vector<entry> entries_;
+  };
+
+  // 分片写时复制: 写者只拷贝一个分片,读者只刷新变化的分片
+  static constexpr size_t shard_count = 256;
+
   registry();
+
   /**
-   * @brief default level: info
+   * @brief build the default color console logger (level info) if it is
+   * still pending; caller holds mutex_
    *
    */
-  void recover_default_();
+  void ensure_default_();
+
+  /**
+   * @brief drop the default logger, the next default path use rebuilds it;
+   * caller holds mutex_
+   *
+   */
+  void reset_default_();
   void throw_if_exists_(const std::string &logger_name);
 
+  /**
+   * @brief register_logger() body; caller holds mutex_
+   *
+   * @param logger
+   */
+  void register_logger_(std::shared_ptr<logger> logger);
+
+  static size_t shard_of_(string_view_t logger_name);
+
+  /**
+   * @brief apply the most specific level rule to logger; caller holds mutex_
+   *
+   * @param logger
+   */
+  void apply_level_rules_(logger &logger) const;
+
+  /**
+   * @brief the calling thread's cached pointer to one shard, refreshed under
+   * the mutex only when a writer published a new version; caller holds a
+   * readers_ guard for as long as it uses the map
+   *
+   * @param shard
+   * @return const logger_map* nullptr when the shard is empty
+   */
+  const logger_map *snapshot_(size_t shard);
+
+  /**
+   * @brief copy-on-write: clone the shard, let modify edit the copy, publish
+   * it and retire the old version; caller holds mutex_
+   *
+   */
+  template <typename Modify> void update_shard_(size_t shard, Modify modify);
+
+  /**
+   * @brief default logger followed by every registered logger
+   *
+   * @return std::vector<std::shared_ptr<logger>>
+   */
+  std::vector<std::shared_ptr<logger>> loggers_snapshot_();
+
+  /**
+   * @brief flush each unique sink of loggers once, in parallel, no lock held
+   *
+   * @param loggers
+   * @return std::vector<flush_result>
+   */
+  std::vector<flush_result>
+  flush_loggers_(const std::vector<std::shared_ptr<logger>> &loggers);
+
+  /**
+   * @brief call fn(logger &) for every registered logger matching glob;
+   * caller holds mutex_
+   *
+   */
+  template <typename Fn> void for_each_matching_(string_view_t glob, Fn fn);
+
+  /**
+   * @brief body of the flush_every thread
+   *
+   */
+  void periodic_flush_();
+
 private:
+  // 最先声明,最后析构: 退休的 map 和 logger 在其他成员之后销毁
+  details::epoch_domain readers_;
   std::mutex mutex_;
-  std::unordered_map<std::string, std::shared_ptr<logger>> mp_;
+  // 写者侧的当前版本,只在 mutex_ 下读写;发布后的 map 不再修改
+  std::array<std::shared_ptr<const logger_map>, shard_count> shards_;
+  std::array<std::atomic<std::uint64_t>, shard_count> shard_versions_{};
+  // 按名字排序的索引,前缀/通配查询只访问匹配区间;裸指针由 shards_ 持有,
+  // 只在 mutex_ 下使用,不产生引用计数
+  std::map<string_view_t, logger *> name_index_;
+  // 层级级别规则,key 为 set_level 的 pattern,只在注册和修改规则时查询
+  std::unordered_map<std::string, level> level_rules_;
   std::shared_ptr<logger> default_logger_;
+  // 默认 logger 延迟创建: pending 时第一次使用才构造 sink/formatter
+  bool default_pending_{true};
+  level default_level_{level::info};
+  // default_logger_ 每次替换都加一,线程本地缓存据此判断是否失效
+  std::atomic<std::uint64_t> default_version_{1};
+  // 并行刷新的常驻线程,首次使用时启动
+  details::worker_pool flush_pool_;
+  // 最后声明,析构时最先停止,回调不会访问已销毁的成员
+  std::unique_ptr<details::periodic_worker> periodic_flusher_;
 };
-} // namespace mispdlog
\ No newline at end of file
+} // namespace mispdlog
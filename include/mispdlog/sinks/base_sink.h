@@ -4,6 +4,8 @@
 #include "mispdlog/formatter.h"
 #include "mispdlog/level.h"
 #include "mispdlog/pattern_formatter.h"
+#include <atomic>
+#include <cstddef>
 #include <fmt/format.h>
 #include <memory>
 #include <mutex>
@@ -30,6 +32,28 @@ public:
    */
   virtual void log(const details::log_message &msg) = 0;
 
+  /**
+   * @brief log bytes already rendered by a formatter with the same
+   * formatter_id(); only called when formatter_id() is nonzero
+   *
+   * @param msg
+   * @param formatted
+   */
+  virtual void log_formatted(const details::log_message &msg,
+                             [[maybe_unused]] string_view_t formatted) {
+    log(msg);
+  }
+
+  /**
+   * @brief render msg with this sink's formatter without writing it; only
+   * called when formatter_id() is nonzero
+   *
+   * @param msg
+   * @param buf
+   */
+  virtual void format([[maybe_unused]] const details::log_message &msg,
+                      [[maybe_unused]] memory_buf_t &buf) {}
+
   /**
    * @brief flush cache
    *
@@ -43,6 +67,23 @@ public:
 
   // Formatter
   virtual void set_formatter(std::unique_ptr<formatter> sink_formatter) = 0;
+
+  /**
+   * @brief formatter::pattern_id() of the current formatter, so the logger
+   * renders once per pattern and hands the bytes to log_formatted(); 0 (the
+   * default) opts out and the sink is simply given log()
+   *
+   * @return size_t
+   */
+  virtual size_t formatter_id() const { return 0; }
+
+  /**
+   * @brief whether the sink reads log_message::payload; a deferred record is
+   * only rendered to text when some sink of the logger does
+   *
+   * @return bool
+   */
+  virtual bool needs_payload() const { return true; }
 };
 
 /**
@@ -54,7 +95,8 @@ template <typename Mutex> class base_sink : public sink {
 public:
   base_sink()
       : level_(level::trace),
-        formatter_(std::make_unique<pattern_formatter>()) {}
+        formatter_(std::make_unique<pattern_formatter>()),
+        formatter_id_(formatter_->pattern_id()) {}
   virtual ~base_sink() = default;
 
   /**
@@ -68,43 +110,75 @@ public:
     sink_it_(msg);
   }
 
+  void log_formatted(const details::log_message &msg,
+                     string_view_t formatted) override {
+    std::lock_guard<Mutex> lock(mutex_);
+    sink_formatted_(msg, formatted);
+  }
+
+  void format(const details::log_message &msg, memory_buf_t &buf) override {
+    std::lock_guard<Mutex> lock(mutex_);
+    format_(msg, buf);
+  }
+
   void flush() override {
     std::lock_guard<Mutex> lock(mutex_);
     flush_();
   }
 
   void set_level(level log_level) override {
-    std::lock_guard<Mutex> lock(mutex_);
-    level_ = log_level;
+    level_.store(log_level, std::memory_order_relaxed);
   }
 
   level get_level() const override {
-    std::lock_guard<Mutex> lock(mutex_);
-    return level_;
+    return level_.load(std::memory_order_relaxed);
   }
 
   bool should_log(level message_level) const override {
-    return message_level >= level_;
+    return message_level >= level_.load(std::memory_order_relaxed);
   }
 
   void set_formatter(std::unique_ptr<formatter> sink_formatter) override {
     std::lock_guard<Mutex> lock(mutex_);
     formatter_ = std::move(sink_formatter);
+    formatter_id_.store(formatter_->pattern_id(), std::memory_order_relaxed);
   }
 
 protected:
   virtual void sink_it_(const details::log_message &msg) = 0;
   virtual void flush_() = 0;
 
+  /**
+   * @brief write pre-rendered bytes; a sink that overrides it opts in to
+   * shared rendering by returning pattern_id_() from formatter_id()
+   *
+   * @param msg
+   * @param formatted
+   */
+  virtual void sink_formatted_(const details::log_message &msg,
+                               [[maybe_unused]] string_view_t formatted) {
+    sink_it_(msg);
+  }
+
+  /**
+   * @brief the current formatter's pattern id, for formatter_id() overrides
+   *
+   * @return size_t
+   */
+  size_t pattern_id_() const {
+    return formatter_id_.load(std::memory_order_relaxed);
+  }
+
   // format message
-  void format_(const details::log_message &message, fmt::memory_buffer &buf) {
+  void format_(const details::log_message &message, memory_buf_t &buf) {
     formatter_->format(message, buf);
   }
 
 protected:
   mutable Mutex mutex_;
-  level level_;
+  std::atomic<level> level_; // 过滤路径只做 relaxed 读取,不争用 mutex_
   std::unique_ptr<formatter> formatter_;
+  std::atomic<size_t> formatter_id_;
 };
 } // namespace sinks
 } // namespace mispdlog
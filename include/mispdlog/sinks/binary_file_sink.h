@@ -0,0 +1,97 @@
+#pragma once
+
+#include "mispdlog/details/log_message.h"
+#include "mispdlog/sinks/base_sink.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace mispdlog {
+namespace sinks {
+
+/**
+ * @brief binary_file_sink: 写紧凑的二进制日志,由 mispdlog-decode 还原为文本
+ * - logger 名和调用点(文件/行/函数/格式串)只在首次出现时写入字典
+ * - 每条记录只有调用点 id、级别、时间增量、线程 id 和消息体
+ * - 延迟格式化(logger::set_deferred_format)的消息只写打包的参数,
+ *   格式串留在字典里; 其余消息写渲染好的 payload
+ * The sink ignores its formatter; see details/binary_format.h for the layout.
+ * @tparam Mutex
+ */
+template <typename Mutex> class binary_file_sink : public base_sink<Mutex> {
+public:
+  /**
+   * @brief
+   *
+   * @param filename
+   * @param truncate true:overwrite, false:append a new session
+   */
+  explicit binary_file_sink(const std::string &filename,
+                            bool truncate = false);
+
+  binary_file_sink(binary_file_sink &&) = delete;
+
+  /**
+   * @brief deferred messages are written from their raw record
+   *
+   * @return bool false
+   */
+  bool needs_payload() const override { return false; }
+
+protected:
+  /**
+   * @brief message.payload is empty for a deferred message when no other
+   * sink of the logger reads it, the record is used instead
+   *
+   * @param message
+   */
+  void sink_it_(const details::log_message &message) override;
+  void flush_() override;
+
+private:
+  // filename/function/signature 是字面量,按指针比较; 格式串按内容比较
+  struct site_key {
+    std::uint64_t name_id;
+    const char *filename;
+    int line;
+    const char *function;
+    string_view_t format;
+    const char *signature;
+
+    bool operator==(const site_key &other) const {
+      return name_id == other.name_id && filename == other.filename &&
+             line == other.line && function == other.function &&
+             format == other.format && signature == other.signature;
+    }
+  };
+
+  struct site_key_hash {
+    size_t operator()(const site_key &key) const;
+  };
+
+  std::uint64_t name_id_(string_view_t name);
+  std::uint64_t site_id_(const details::log_message &message,
+                         std::uint64_t name_id);
+
+private:
+  std::ofstream file_;
+  memory_buf_t buf_;
+  std::map<std::string, std::uint64_t, std::less<>> names_;
+  // 连续消息多来自同一 logger,先比较上一次的名字
+  std::string last_name_;
+  std::uint64_t last_name_id_{0};
+  std::unordered_map<site_key, std::uint64_t, site_key_hash> sites_;
+  // sites_ 中 format 视图指向的副本,deque 扩容时元素地址不变
+  std::deque<std::string> site_formats_;
+  std::int64_t last_time_{0};
+};
+
+using binary_file_sink_mt = binary_file_sink<std::mutex>;
+using binary_file_sink_st = binary_file_sink<null_mutex>;
+} // namespace sinks
+} // namespace mispdlog
@@ -38,13 +38,20 @@ public:
 
   ~color_console_sink() = default;
 
+  size_t formatter_id() const override { return this->pattern_id_(); }
+
 protected:
   void sink_it_(const details::log_message &message) override {
-    fmt::memory_buffer buf;
+    memory_buf_t buf;
     this->format_(message, buf);
+    sink_formatted_(message, string_view_t(buf.data(), buf.size()));
+  }
+
+  void sink_formatted_(const details::log_message &message,
+                       string_view_t formatted) override {
     const std::string &prefix = colors_[static_cast<int>(message.level)];
     std::cout << prefix;
-    std::cout.write(buf.data(), buf.size());
+    std::cout.write(formatted.data(), formatted.size());
     std::cout << color::reset;
   }
 
@@ -70,13 +77,20 @@ public:
 
   ~color_stderr_sink() = default;
 
+  size_t formatter_id() const override { return this->pattern_id_(); }
+
 protected:
   void sink_it_(const details::log_message &message) override {
-    fmt::memory_buffer buf;
+    memory_buf_t buf;
     this->format_(message, buf);
+    sink_formatted_(message, string_view_t(buf.data(), buf.size()));
+  }
+
+  void sink_formatted_(const details::log_message &message,
+                       string_view_t formatted) override {
     const std::string &prefix = colors_[static_cast<int>(message.level)];
     std::cerr << prefix;
-    std::cerr.write(buf.data(), buf.size());
+    std::cerr.write(formatted.data(), formatted.size());
     std::cerr << color::reset;
   }
 
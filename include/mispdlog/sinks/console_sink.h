@@ -9,10 +9,18 @@ namespace mispdlog {
 namespace sinks {
 
 template <typename Mutex> class console_sink : public base_sink<Mutex> {
+public:
+  size_t formatter_id() const override { return this->pattern_id_(); }
+
 protected:
   void sink_it_(const details::log_message &msg) override {
-    fmt::memory_buffer formatted;
+    memory_buf_t formatted;
     this->format_(msg, formatted);
+    sink_formatted_(msg, string_view_t(formatted.data(), formatted.size()));
+  }
+
+  void sink_formatted_([[maybe_unused]] const details::log_message &msg,
+                       string_view_t formatted) override {
     std::cout.write(formatted.data(), formatted.size()); // out
   }
 
@@ -23,10 +31,18 @@ using console_sink_mt = console_sink<std::mutex>;
 using console_sink_st = console_sink<null_mutex>;
 
 template <typename Mutex> class stderr_sink : public base_sink<Mutex> {
+public:
+  size_t formatter_id() const override { return this->pattern_id_(); }
+
 protected:
   void sink_it_(const details::log_message &msg) override {
-    fmt::memory_buffer formatted;
+    memory_buf_t formatted;
     this->format_(msg, formatted);
+    sink_formatted_(msg, string_view_t(formatted.data(), formatted.size()));
+  }
+
+  void sink_formatted_([[maybe_unused]] const details::log_message &msg,
+                       string_view_t formatted) override {
     std::cerr.write(formatted.data(), formatted.size()); // out
   }
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "mispdlog/details/log_message.h"
+#include "mispdlog/formatter.h"
+#include "mispdlog/level.h"
+#include "mispdlog/sinks/base_sink.h"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mispdlog {
+namespace sinks {
+
+/**
+ * @brief dup_filter_sink: 丢弃时间窗口内连续重复的消息后转发给子 sink
+ * - 与上一条输出的消息 level 和 payload 都相同,且距其不到 max_skip_duration
+ *   时丢弃
+ * - 出现不同的消息(或 flush)时,先输出一条 "Skipped N duplicate messages.."
+ * - payload 只计算一次哈希,哈希相同才逐字节比较
+ * @tparam Mutex
+ */
+template <typename Mutex> class dup_filter_sink : public base_sink<Mutex> {
+public:
+  explicit dup_filter_sink(std::chrono::milliseconds max_skip_duration);
+  dup_filter_sink(std::chrono::milliseconds max_skip_duration,
+                  std::vector<sink_ptr> sinks);
+
+  void add_sink(sink_ptr sink);
+  void remove_sink(sink_ptr sink);
+
+  /**
+   * @brief give every wrapped sink a clone of sink_formatter
+   *
+   * @param sink_formatter
+   */
+  void set_formatter(std::unique_ptr<formatter> sink_formatter) override;
+
+protected:
+  void sink_it_(const details::log_message &message) override;
+
+  /**
+   * @brief report pending skipped duplicates, then flush the wrapped sinks
+   *
+   */
+  void flush_() override;
+
+private:
+  bool is_duplicate_(const details::log_message &message, size_t hash) const;
+  void forward_(const details::log_message &message);
+
+  /**
+   * @brief emit the "Skipped N duplicate messages.." line if any
+   *
+   * @param time
+   */
+  void report_skipped_(log_clock::time_point time);
+
+private:
+  std::vector<sink_ptr> sinks_;
+  log_clock::duration max_skip_duration_;
+
+  // 上一条转发出去的消息
+  bool has_last_{false};
+  size_t last_hash_{0};
+  level last_level_{level::off};
+  log_clock::time_point last_time_;
+  std::string last_payload_;
+  std::string last_logger_name_;
+  size_t skipped_{0};
+};
+
+using dup_filter_sink_mt = dup_filter_sink<std::mutex>;
+using dup_filter_sink_st = dup_filter_sink<null_mutex>;
+} // namespace sinks
+} // namespace mispdlog
@@ -35,12 +35,19 @@ public:
     }
   }
 
+  size_t formatter_id() const override { return this->pattern_id_(); }
+
 protected:
   void sink_it_(const details::log_message &message) override {
-    fmt::memory_buffer buf;
+    memory_buf_t buf;
     this->format_(message, buf);
+    sink_formatted_(message, string_view_t(buf.data(), buf.size()));
+  }
+
+  void sink_formatted_([[maybe_unused]] const details::log_message &message,
+                       string_view_t formatted) override {
     // write
-    file_.write(buf.data(), buf.size());
+    file_.write(formatted.data(), formatted.size());
   }
 
   void flush_() override { file_.flush(); }
@@ -38,8 +38,12 @@ public:
    */
   static std::string calc_filename(const std::string &filename, size_t index);
 
+  size_t formatter_id() const override { return this->pattern_id_(); }
+
 protected:
   void sink_it_(const details::log_message &message) override;
+  void sink_formatted_(const details::log_message &message,
+                       string_view_t formatted) override;
   void flush_() override;
 
 private:
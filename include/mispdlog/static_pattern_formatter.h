@@ -0,0 +1,302 @@
+#pragma once
+
+#include "mispdlog/details/fmt_helper.h"
+#include "mispdlog/details/log_message.h"
+#include "mispdlog/details/utils.h"
+#include "mispdlog/formatter.h"
+#include "mispdlog/level.h"
+#include "mispdlog/pattern_formatter.h"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <fmt/format.h>
+#include <memory>
+#include <typeinfo>
+#include <utility>
+
+namespace mispdlog {
+namespace details {
+
+/**
+ * @brief one segment of a pattern: a flag (%Y ...) or raw text
+ * [begin, begin + length)
+ *
+ */
+struct pattern_token {
+  char flag{0}; // 0 表示原样输出的文本
+  size_t begin{0};
+  size_t length{0};
+};
+
+constexpr size_t const_strlen(const char *str) noexcept {
+  size_t len = 0;
+  while (str[len] != '\0') {
+    len++;
+  }
+  return len;
+}
+
+/**
+ * @brief scan one token starting at pos, same rules as
+ * pattern_formatter::compile_pattern: "%%" is a literal '%', an unknown flag
+ * is kept as text and a trailing lone '%' is dropped
+ *
+ * @return size_t position after the token
+ */
+constexpr size_t scan_pattern_token(const char *pattern, size_t len,
+                                    size_t pos, pattern_token &token) noexcept {
+  if (pattern[pos] == '%') {
+    if (pos + 1 >= len) {
+      token = pattern_token{0, pos, 0};
+      return len;
+    }
+    char flag = pattern[pos + 1];
+    if (is_pattern_flag(flag)) {
+      token = pattern_token{flag, pos, 2};
+      return pos + 2;
+    }
+    if (flag == '%') {
+      token = pattern_token{0, pos, 1};
+      return pos + 2;
+    }
+  }
+  size_t begin = pos;
+  while (pos < len) {
+    if (pattern[pos] != '%') {
+      pos++;
+      continue;
+    }
+    if (pos + 1 >= len || is_pattern_flag(pattern[pos + 1]) ||
+        pattern[pos + 1] == '%') {
+      break;
+    }
+    pos += 2; // 未知占位符按原样输出
+  }
+  token = pattern_token{0, begin, pos - begin};
+  return pos;
+}
+
+constexpr size_t count_pattern_tokens(const char *pattern, size_t len) {
+  size_t count = 0;
+  pattern_token token;
+  for (size_t pos = 0; pos < len; count++) {
+    pos = scan_pattern_token(pattern, len, pos, token);
+  }
+  return count;
+}
+
+constexpr pattern_token pattern_token_at(const char *pattern, size_t len,
+                                         size_t index) {
+  pattern_token token;
+  size_t pos = 0;
+  for (size_t i = 0; i <= index; i++) {
+    pos = scan_pattern_token(pattern, len, pos, token);
+  }
+  return token;
+}
+
+constexpr bool pattern_needs_time(const char *pattern, size_t len) {
+  pattern_token token;
+  for (size_t pos = 0; pos < len;) {
+    pos = scan_pattern_token(pattern, len, pos, token);
+    if (is_time_flag(token.flag)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief index of the first (or last) time flag token, token count if none
+ *
+ */
+constexpr size_t time_token_index(const char *pattern, size_t len,
+                                  bool last) {
+  size_t found = count_pattern_tokens(pattern, len);
+  pattern_token token;
+  size_t index = 0;
+  for (size_t pos = 0; pos < len; index++) {
+    pos = scan_pattern_token(pattern, len, pos, token);
+    if (is_time_flag(token.flag)) {
+      found = index;
+      if (last == false) {
+        break;
+      }
+    }
+  }
+  return found;
+}
+
+/**
+ * @brief true if tokens [first, last] are only time flags and raw text, so the
+ * whole run renders the same bytes for a whole second
+ *
+ */
+constexpr bool is_pure_time_run(const char *pattern, size_t len, size_t first,
+                                size_t last) {
+  for (size_t i = first; i <= last; i++) {
+    char flag = pattern_token_at(pattern, len, i).flag;
+    if (flag != 0 && is_time_flag(flag) == false) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace details
+
+/**
+ * @brief pattern_formatter whose pattern is parsed at compile time; the line
+ * is assembled by a fold over the token list, so there is no virtual call
+ * or loop per flag. C++17 has no string literal template parameters, the
+ * pattern must be a constexpr char array with static storage:
+ *
+ *   static constexpr char k_pattern[] = "[%H:%M:%S][%l] %v";
+ *   sink->set_formatter(
+ *       std::make_unique<static_pattern_formatter<k_pattern>>());
+ *
+ * Output is byte-identical to pattern_formatter(k_pattern).
+ * @tparam Pattern
+ */
+template <const char *Pattern>
+class static_pattern_formatter : public formatter {
+public:
+  // 输出与 pattern_formatter 逐字节相同,共用它的 id
+  static_pattern_formatter()
+      : pattern_id_(details::intern_pattern(typeid(pattern_formatter),
+                                            Pattern)) {}
+
+  void format(const details::log_message &msg, memory_buf_t &buf) override {
+    if constexpr (needs_time_) {
+      // update tm when seconds change
+      auto secs = std::chrono::duration_cast<std::chrono::seconds>(
+          msg.time.time_since_epoch());
+      if (secs != last_log_seconds_) {
+        last_log_seconds_ = secs;
+        cached_tm_ = details::localtime(log_clock::to_time_t(msg.time));
+        if constexpr (cache_time_) {
+          time_cache_.clear();
+          format_tokens_<first_time_>(
+              msg, time_cache_,
+              std::make_index_sequence<last_time_ - first_time_ + 1>{});
+        }
+      }
+    }
+    if constexpr (cache_time_) {
+      // 时间段每秒只渲染一次,其余消息只做一次拷贝
+      format_tokens_<0>(msg, buf, std::make_index_sequence<first_time_>{});
+      buf.append(time_cache_.data(), time_cache_.data() + time_cache_.size());
+      format_tokens_<last_time_ + 1>(
+          msg, buf, std::make_index_sequence<token_count_ - last_time_ - 1>{});
+    } else {
+      format_tokens_<0>(msg, buf, std::make_index_sequence<token_count_>{});
+    }
+    buf.push_back('\n');
+  }
+
+  std::unique_ptr<formatter> clone() const override {
+    return std::make_unique<static_pattern_formatter>();
+  }
+
+  size_t pattern_id() const override {
+    if (typeid(*this) == typeid(static_pattern_formatter)) {
+      return pattern_id_;
+    }
+    return details::intern_pattern(typeid(*this), Pattern);
+  }
+
+private:
+  static constexpr size_t length_ = details::const_strlen(Pattern);
+  static constexpr size_t token_count_ =
+      details::count_pattern_tokens(Pattern, length_);
+  static constexpr bool needs_time_ =
+      details::pattern_needs_time(Pattern, length_);
+  static constexpr size_t first_time_ =
+      details::time_token_index(Pattern, length_, false);
+  static constexpr size_t last_time_ =
+      details::time_token_index(Pattern, length_, true);
+  static constexpr bool cache_time_ =
+      needs_time_ &&
+      details::is_pure_time_run(Pattern, length_, first_time_, last_time_);
+
+  template <size_t Index>
+  static constexpr details::pattern_token token_ =
+      details::pattern_token_at(Pattern, length_, Index);
+
+  template <size_t Offset, size_t... Index>
+  void format_tokens_(const details::log_message &msg, memory_buf_t &buf,
+                      std::index_sequence<Index...>) {
+    (format_token_<token_<Offset + Index>.flag, token_<Offset + Index>.begin,
+                   token_<Offset + Index>.length>(msg, buf),
+     ...);
+  }
+
+  template <char Flag, size_t Begin, size_t Length>
+  void format_token_(const details::log_message &msg, memory_buf_t &buf) {
+    if constexpr (Flag == 0) {
+      buf.append(Pattern + Begin, Pattern + Begin + Length);
+    } else if constexpr (Flag == 'Y') {
+      details::pad4(cached_tm_.tm_year + 1900, buf);
+    } else if constexpr (Flag == 'm') {
+      details::pad2(cached_tm_.tm_mon + 1, buf);
+    } else if constexpr (Flag == 'd') {
+      details::pad2(cached_tm_.tm_mday, buf);
+    } else if constexpr (Flag == 'H') {
+      details::pad2(cached_tm_.tm_hour, buf);
+    } else if constexpr (Flag == 'M') {
+      details::pad2(cached_tm_.tm_min, buf);
+    } else if constexpr (Flag == 'S') {
+      details::pad2(cached_tm_.tm_sec, buf);
+    } else if constexpr (Flag == 'e') {
+      details::pad_uint<3>(
+          details::time_fraction<std::chrono::milliseconds>(msg.time), buf);
+    } else if constexpr (Flag == 'f') {
+      details::pad_uint<6>(
+          details::time_fraction<std::chrono::microseconds>(msg.time), buf);
+    } else if constexpr (Flag == 'F') {
+      details::pad_uint<9>(
+          details::time_fraction<std::chrono::nanoseconds>(msg.time), buf);
+    } else if constexpr (Flag == 'l') {
+      const char *level_str = level_to_short_string(msg.level);
+      buf.append(level_str, level_str + std::strlen(level_str));
+    } else if constexpr (Flag == 'L') {
+      const char *level_str = level_to_string(msg.level);
+      buf.append(level_str, level_str + std::strlen(level_str));
+    } else if constexpr (Flag == 'n') {
+      buf.append(msg.logger_name.data(),
+                 msg.logger_name.data() + msg.logger_name.size());
+    } else if constexpr (Flag == 'v') {
+      buf.append(msg.payload.data(), msg.payload.data() + msg.payload.size());
+    } else if constexpr (Flag == 't') {
+      details::append_uint(msg.thread_id, buf);
+    } else if constexpr (Flag == 's' || Flag == '@') {
+      if (msg.loc.empty() == false) {
+        auto base = basenames_.get(msg.loc.filename);
+        buf.append(base.data(), base.data() + base.size());
+        if constexpr (Flag == '@') {
+          buf.push_back(':');
+          details::append_uint(static_cast<std::uint64_t>(msg.loc.line), buf);
+        }
+      }
+    } else if constexpr (Flag == '#') {
+      if (msg.loc.empty() == false) {
+        details::append_uint(static_cast<std::uint64_t>(msg.loc.line), buf);
+      }
+    } else if constexpr (Flag == '!') {
+      if (msg.loc.empty() == false) {
+        const char *func = msg.loc.function_name;
+        buf.append(func, func + std::strlen(func));
+      }
+    }
+  }
+
+private:
+  size_t pattern_id_;
+
+  // 缓存上次格式化的时间，优化时间格式化性能
+  std::chrono::seconds last_log_seconds_{std::chrono::seconds::min()};
+  std::tm cached_tm_{};
+  memory_buf_t time_cache_;
+  details::basename_cache basenames_;
+};
+} // namespace mispdlog
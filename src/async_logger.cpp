@@ -0,0 +1,353 @@
+#include "mispdlog/async_logger.h"
+#include "mispdlog/details/async_msg.h"
+#include "mispdlog/details/spsc_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <utility>
+
+namespace mispdlog {
+namespace details {
+/**
+ * @brief one producer thread's queue of one per_thread async_logger; shared
+ * by the thread's local table and the backend, freed by whichever lets go
+ * last
+ *
+ */
+struct producer_ring {
+  explicit producer_ring(size_t capacity)
+      : queue(std::make_unique<spsc_queue<async_msg>>(capacity)) {}
+
+  // logger 析构时释放,线程本地表里只剩这个空壳
+  std::unique_ptr<spsc_queue<async_msg>> queue;
+  // 生产线程退出时置位(release),后台排空后回收
+  std::atomic<bool> closed{false};
+  // async_logger 析构后置位,线程本地表据此清理
+  std::atomic<bool> orphaned{false};
+};
+} // namespace details
+
+namespace {
+std::atomic<std::uint64_t> next_logger_id{1};
+
+// 当前线程在各个 per_thread async_logger 中的环
+struct local_rings {
+  struct entry {
+    std::uint64_t logger_id;
+    std::shared_ptr<details::producer_ring> ring;
+  };
+  std::vector<entry> entries;
+
+  ~local_rings() {
+    for (const auto &e : entries) {
+      e.ring->closed.store(true, std::memory_order_release);
+    }
+  }
+};
+
+thread_local local_rings thread_rings;
+
+// 缺省队列长度下每个 ring 占用可观内存,per_thread 模式不需要共享队列
+size_t shared_queue_size(size_t queue_size, async_queue_mode mode) {
+  return mode == async_queue_mode::per_thread ? 2 : queue_size;
+}
+
+void check_mode(async_overflow_policy policy, async_queue_mode mode) {
+  if (mode == async_queue_mode::per_thread &&
+      policy == async_overflow_policy::overrun_oldest) {
+    throw std::invalid_argument(
+        "async_logger: overrun_oldest is not supported in per_thread mode");
+  }
+}
+} // namespace
+
+async_logger::async_logger(std::string name, sinks::sink_ptr single_sink,
+                           size_t queue_size, async_overflow_policy policy,
+                           async_queue_mode mode, size_t ring_size)
+    : logger(std::move(name), std::move(single_sink)),
+      queue_(shared_queue_size(queue_size, mode)), policy_(policy),
+      mode_(mode), ring_size_(ring_size),
+      id_(next_logger_id.fetch_add(1, std::memory_order_relaxed)) {
+  check_mode(policy, mode);
+  start_worker_();
+}
+
+async_logger::async_logger(std::string name,
+                           std::vector<sinks::sink_ptr> sinks,
+                           size_t queue_size, async_overflow_policy policy,
+                           async_queue_mode mode, size_t ring_size)
+    : logger(std::move(name), std::move(sinks)),
+      queue_(shared_queue_size(queue_size, mode)), policy_(policy),
+      mode_(mode), ring_size_(ring_size),
+      id_(next_logger_id.fetch_add(1, std::memory_order_relaxed)) {
+  check_mode(policy, mode);
+  start_worker_();
+}
+
+async_logger::~async_logger() {
+  if (mode_ == async_queue_mode::per_thread) {
+    stop_.store(true, std::memory_order_release);
+  } else {
+    // 不受溢出策略影响,保证退出消息一定入队
+    queue_.enqueue(details::async_msg(details::async_msg_type::terminate));
+  }
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+  // 不会再有线程向这些环写入,先释放槽位,空壳留给线程本地表清理
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  for (const auto &ring : rings_) {
+    ring->queue.reset();
+    ring->orphaned.store(true, std::memory_order_release);
+  }
+  for (const auto &ring : pending_rings_) {
+    ring->queue.reset();
+    ring->orphaned.store(true, std::memory_order_release);
+  }
+}
+
+async_overflow_policy async_logger::overflow_policy() const { return policy_; }
+
+async_queue_mode async_logger::queue_mode() const { return mode_; }
+
+size_t async_logger::dropped_count() const {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+void async_logger::sink_it_(const details::log_message &message) {
+  enqueue_(details::async_msg(details::async_msg_type::log, message));
+}
+
+void async_logger::sink_deferred_(details::async_msg &&record) {
+  enqueue_(std::move(record));
+}
+
+void async_logger::enqueue_(details::async_msg &&msg) {
+  if (mode_ == async_queue_mode::per_thread) {
+    enqueue_ring_(std::move(msg), policy_ == async_overflow_policy::block);
+    return;
+  }
+  switch (policy_) {
+  case async_overflow_policy::block:
+    queue_.enqueue(std::move(msg));
+    break;
+  case async_overflow_policy::discard_new:
+    if (queue_.try_enqueue(std::move(msg)) == false) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    break;
+  case async_overflow_policy::overrun_oldest:
+    overrun_enqueue_(std::move(msg));
+    break;
+  }
+}
+
+void async_logger::overrun_enqueue_(details::async_msg &&msg) {
+  while (queue_.try_enqueue(std::move(msg)) == false) {
+    details::async_msg evicted;
+    if (queue_.try_dequeue(evicted) == false) {
+      continue; // 后台线程刚好腾出了空间
+    }
+    if (evicted.type == details::async_msg_type::log) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    // flush/terminate 不能丢,也不能由当前线程代为完成(后台可能还有已取出
+    // 未写完的消息): 放回队尾,仍由后台线程处理
+    overrun_enqueue_(std::move(evicted));
+  }
+}
+
+void async_logger::flush_() {
+  auto flush_id = flush_requested_.fetch_add(1, std::memory_order_relaxed) + 1;
+  details::async_msg request(details::async_msg_type::flush, flush_id);
+  if (mode_ == async_queue_mode::per_thread) {
+    // 带上时间戳,归并时排在此前其他线程的消息之后
+    request.time = log_clock::now();
+    enqueue_ring_(std::move(request), true);
+  } else {
+    queue_.enqueue(std::move(request));
+  }
+  std::unique_lock<std::mutex> lock(flush_mutex_);
+  auto done = flush_done_.end();
+  flush_cv_.wait(lock, [&]() {
+    done = std::find(flush_done_.begin(), flush_done_.end(), flush_id);
+    return done != flush_done_.end();
+  });
+  flush_done_.erase(done);
+}
+
+details::producer_ring &async_logger::local_ring_() {
+  auto &entries = thread_rings.entries;
+  for (const auto &e : entries) {
+    if (e.logger_id == id_) {
+      return *e.ring;
+    }
+  }
+  // 首次使用: 顺带清理已析构 logger 留下的环
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [](const local_rings::entry &e) {
+                                 return e.ring->orphaned.load(
+                                     std::memory_order_acquire);
+                               }),
+                entries.end());
+  auto ring = std::make_shared<details::producer_ring>(ring_size_);
+  entries.push_back({id_, ring});
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    pending_rings_.emplace_back(std::move(ring));
+  }
+  rings_pending_.store(true, std::memory_order_release);
+  return *entries.back().ring;
+}
+
+void async_logger::enqueue_ring_(details::async_msg &&msg, bool block) {
+  auto &queue = *local_ring_().queue;
+  if (block == false) {
+    if (queue.try_enqueue(std::move(msg)) == false) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+  // 失败的 try_enqueue 不会移走 msg
+  for (size_t spins = 0; queue.try_enqueue(std::move(msg)) == false; spins++) {
+    if (spins > 64) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool async_logger::merge_rings_() {
+  if (rings_pending_.exchange(false, std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto &ring : pending_rings_) {
+      rings_.emplace_back(std::move(ring));
+    }
+    pending_rings_.clear();
+  }
+
+  // k 路归并: 小顶堆存每个非空环的队首时间
+  merge_heap_.clear();
+  for (size_t i = 0; i < rings_.size(); i++) {
+    if (const auto *msg = rings_[i]->queue->front()) {
+      merge_heap_.emplace_back(msg->time, i);
+    }
+  }
+  auto later = [](const std::pair<log_clock::time_point, size_t> &a,
+                  const std::pair<log_clock::time_point, size_t> &b) {
+    return a.first > b.first;
+  };
+  std::make_heap(merge_heap_.begin(), merge_heap_.end(), later);
+  // 每轮最多处理 ring_size_ 条,让新出现消息的环及时加入归并
+  size_t processed = 0;
+  while (merge_heap_.empty() == false && processed < ring_size_) {
+    std::pop_heap(merge_heap_.begin(), merge_heap_.end(), later);
+    size_t index = merge_heap_.back().second;
+    merge_heap_.pop_back();
+    auto &queue = *rings_[index]->queue;
+    process_(*queue.front());
+    queue.pop();
+    processed++;
+    if (const auto *next = queue.front()) {
+      merge_heap_.emplace_back(next->time, index);
+      std::push_heap(merge_heap_.begin(), merge_heap_.end(), later);
+    }
+  }
+
+  // 先读 closed 再判空: 线程退出前的消息都已可见
+  rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                              [](const auto &ring) {
+                                return ring->closed.load(
+                                           std::memory_order_acquire) &&
+                                       ring->queue->front() == nullptr;
+                              }),
+               rings_.end());
+  return processed > 0;
+}
+
+void async_logger::start_worker_() {
+  worker_ = std::thread([this]() { worker_loop_(); });
+}
+
+void async_logger::worker_loop_() {
+  details::async_msg msg;
+  size_t idle = 0;
+  for (;;) {
+    if (mode_ == async_queue_mode::per_thread) {
+      if (merge_rings_()) {
+        idle = 0;
+        continue;
+      }
+      if (stop_.load(std::memory_order_acquire)) {
+        // 析构前写入的消息此时都已可见,再排空一次
+        while (merge_rings_()) {
+        }
+        return;
+      }
+    } else if (queue_.try_dequeue(msg)) {
+      idle = 0;
+      if (process_(msg) == false) {
+        return;
+      }
+      continue;
+    }
+    // 队列为空: 先自旋,再让出,最后休眠,避免空转占满一个核
+    idle++;
+    if (idle < 64) {
+      continue;
+    } else if (idle < 256) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+bool async_logger::process_(const details::async_msg &msg) {
+  try {
+    switch (msg.type) {
+    case details::async_msg_type::log:
+      if (msg.deferred != nullptr) {
+        // 延迟格式化的记录在后台线程渲染
+        memory_buf_t buf;
+        backend_sink_it_(deferred_message_(msg, buf));
+      } else {
+        backend_sink_it_(msg.to_log_message(name_));
+      }
+      break;
+    case details::async_msg_type::flush:
+      backend_flush_(msg.flush_id);
+      break;
+    case details::async_msg_type::terminate:
+      return false;
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "[mispdlog] async logger '{}' error: {}\n", name_,
+               e.what());
+  }
+  return true;
+}
+
+void async_logger::backend_sink_it_(const details::log_message &message) {
+  fan_out_(message);
+  if (message.level >= flush_level_.load(std::memory_order_relaxed)) {
+    backend_flush_(0);
+  }
+}
+
+void async_logger::backend_flush_(std::uint64_t flush_id) {
+  for (const auto &sink : sinks_) {
+    sink->flush();
+  }
+  if (flush_id == 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    flush_done_.push_back(flush_id);
+  }
+  flush_cv_.notify_all();
+}
+} // namespace mispdlog
@@ -0,0 +1,38 @@
+#include "mispdlog/details/backtracer.h"
+
+namespace mispdlog {
+namespace details {
+void backtracer::enable(size_t size, level trigger) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ring_.clear();
+  ring_.resize(size);
+  head_ = 0;
+  count_ = 0;
+  trigger_.store(trigger, std::memory_order_relaxed);
+  enabled_.store(size > 0, std::memory_order_relaxed);
+}
+
+void backtracer::disable() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  enabled_.store(false, std::memory_order_relaxed);
+  ring_.clear();
+  ring_.shrink_to_fit();
+  head_ = 0;
+  count_ = 0;
+}
+
+void backtracer::push(const log_message &msg) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (ring_.empty()) {
+    return; // 已被 disable
+  }
+  size_t pos = (head_ + count_) % ring_.size();
+  ring_[pos].assign(async_msg_type::log, msg);
+  if (count_ == ring_.size()) {
+    head_ = (head_ + 1) % ring_.size(); // 覆盖最旧的消息
+  } else {
+    count_++;
+  }
+}
+} // namespace details
+} // namespace mispdlog
@@ -0,0 +1,345 @@
+#include "mispdlog/details/binary_format.h"
+#include "mispdlog/details/deferred_args.h"
+#include <chrono>
+#include <cstring>
+#include <fmt/args.h>
+#include <fmt/format.h>
+#include <iterator>
+#include <stdexcept>
+
+namespace mispdlog {
+namespace details {
+namespace binary {
+namespace {
+/**
+ * @brief bounds checked cursor over packed arguments
+ *
+ */
+class cursor {
+public:
+  explicit cursor(string_view_t data) : pos_(data.data()), end_(pos_) {
+    end_ += data.size();
+  }
+
+  template <typename T> T raw() {
+    T value;
+    std::memcpy(&value, take_(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::uint64_t varint() {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      auto byte = static_cast<std::uint8_t>(*take_(1));
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    throw std::runtime_error("binary log: varint too long");
+  }
+
+  string_view_t bytes(size_t size) {
+    const char *data = take_(size);
+    return string_view_t(data, size);
+  }
+
+  bool done() const { return pos_ == end_; }
+
+private:
+  const char *take_(size_t size) {
+    if (static_cast<size_t>(end_ - pos_) < size) {
+      throw std::runtime_error("binary log: truncated arguments");
+    }
+    const char *data = pos_;
+    pos_ += size;
+    return data;
+  }
+
+  const char *pos_;
+  const char *end_;
+};
+
+template <typename T> void put_raw(T value, memory_buf_t &out) {
+  const char *bytes = reinterpret_cast<const char *>(&value);
+  out.append(bytes, bytes + sizeof(T));
+}
+
+template <typename T> void pack_signed(cursor &in, memory_buf_t &out) {
+  put_varint(zigzag(in.raw<T>()), out);
+}
+
+template <typename T> void pack_unsigned(cursor &in, memory_buf_t &out) {
+  put_varint(in.raw<T>(), out);
+}
+
+template <typename T>
+void unpack_signed(cursor &in,
+                   fmt::dynamic_format_arg_store<fmt::format_context> &store) {
+  store.push_back(static_cast<T>(unzigzag(in.varint())));
+}
+
+template <typename T>
+void unpack_unsigned(
+    cursor &in, fmt::dynamic_format_arg_store<fmt::format_context> &store) {
+  store.push_back(static_cast<T>(in.varint()));
+}
+} // namespace
+
+void pack_args(const char *signature, string_view_t record,
+               memory_buf_t &out) {
+  cursor in(record.substr(deferred_args_offset(record.data())));
+  for (const char *tag = signature; *tag != '\0'; tag++) {
+    switch (*tag) {
+    case '?':
+      out.push_back(static_cast<char>(in.raw<bool>()));
+      break;
+    case 'c':
+    case 'b':
+    case 'B':
+      out.push_back(in.raw<char>());
+      break;
+    case 'h':
+      pack_signed<std::int16_t>(in, out);
+      break;
+    case 'i':
+      pack_signed<std::int32_t>(in, out);
+      break;
+    case 'q':
+      pack_signed<std::int64_t>(in, out);
+      break;
+    case 'H':
+      pack_unsigned<std::uint16_t>(in, out);
+      break;
+    case 'I':
+      pack_unsigned<std::uint32_t>(in, out);
+      break;
+    case 'Q':
+      pack_unsigned<std::uint64_t>(in, out);
+      break;
+    case 'f':
+      put_raw(in.raw<float>(), out);
+      break;
+    case 'd':
+      put_raw(in.raw<double>(), out);
+      break;
+    case 'g':
+      put_raw(in.raw<long double>(), out);
+      break;
+    case 'z':
+    case 's': {
+      auto size = in.raw<size_t>();
+      if (size == deferred_text::null_length) {
+        put_string(nullptr, 0, out);
+        break;
+      }
+      string_view_t text = in.bytes(size);
+      in.bytes(1); // '\0'
+      put_string(text.data(), text.size(), out);
+      break;
+    }
+    default:
+      throw std::runtime_error(
+          fmt::format("binary log: unknown argument tag '{}'", *tag));
+    }
+  }
+}
+
+void format_args(string_view_t format, const char *signature,
+                 string_view_t args, memory_buf_t &out) {
+  fmt::dynamic_format_arg_store<fmt::format_context> store;
+  cursor in(args);
+  for (const char *tag = signature; *tag != '\0'; tag++) {
+    switch (*tag) {
+    case '?':
+      store.push_back(in.raw<char>() != 0);
+      break;
+    case 'c':
+      store.push_back(in.raw<char>());
+      break;
+    case 'b':
+      store.push_back(in.raw<signed char>());
+      break;
+    case 'B':
+      store.push_back(in.raw<unsigned char>());
+      break;
+    case 'h':
+      unpack_signed<short>(in, store);
+      break;
+    case 'i':
+      unpack_signed<std::int32_t>(in, store);
+      break;
+    case 'q':
+      unpack_signed<std::int64_t>(in, store);
+      break;
+    case 'H':
+      unpack_unsigned<unsigned short>(in, store);
+      break;
+    case 'I':
+      unpack_unsigned<std::uint32_t>(in, store);
+      break;
+    case 'Q':
+      unpack_unsigned<std::uint64_t>(in, store);
+      break;
+    case 'f':
+      store.push_back(in.raw<float>());
+      break;
+    case 'd':
+      store.push_back(in.raw<double>());
+      break;
+    case 'g':
+      store.push_back(in.raw<long double>());
+      break;
+    case 'z':
+    case 's': {
+      auto size = in.varint();
+      if (size == 0) {
+        throw std::runtime_error("binary log: null string argument");
+      }
+      store.push_back(in.bytes(size - 1));
+      break;
+    }
+    default:
+      throw std::runtime_error(
+          fmt::format("binary log: unknown argument tag '{}'", *tag));
+    }
+  }
+  if (in.done() == false) {
+    throw std::runtime_error("binary log: arguments do not match signature");
+  }
+  fmt::vformat_to(std::back_inserter(out),
+                  fmt::string_view(format.data(), format.size()), store);
+}
+} // namespace binary
+
+binary_reader::binary_reader(const std::string &filename)
+    : file_(filename, std::ios::in | std::ios::binary) {
+  if (file_.is_open() == false) {
+    throw std::runtime_error("binary_reader: Failed to open file: " +
+                             filename);
+  }
+  if (file_.peek() != static_cast<int>(binary::chunk::session)) {
+    throw std::runtime_error("binary_reader: not a mispdlog binary log: " +
+                             filename);
+  }
+}
+
+bool binary_reader::next(log_message &msg) {
+  for (;;) {
+    int tag = file_.get();
+    if (tag == std::ifstream::traits_type::eof()) {
+      return false;
+    }
+    switch (static_cast<binary::chunk>(tag)) {
+    case binary::chunk::session:
+      read_session_();
+      break;
+    case binary::chunk::name: {
+      size_t id = read_varint_();
+      if (id != names_.size()) {
+        throw std::runtime_error("binary_reader: unexpected name id");
+      }
+      names_.emplace_back();
+      read_string_(names_.back());
+      break;
+    }
+    case binary::chunk::site: {
+      size_t id = read_varint_();
+      if (id != sites_.size()) {
+        throw std::runtime_error("binary_reader: unexpected site id");
+      }
+      site s;
+      s.name_id = read_varint_();
+      if (s.name_id >= names_.size()) {
+        throw std::runtime_error("binary_reader: unknown name id");
+      }
+      s.has_filename = read_string_(s.filename);
+      s.line = static_cast<int>(read_varint_());
+      s.has_function = read_string_(s.function);
+      s.has_format = read_string_(s.format);
+      read_string_(s.signature);
+      sites_.push_back(std::move(s));
+      break;
+    }
+    case binary::chunk::record: {
+      size_t id = read_varint_();
+      if (id >= sites_.size()) {
+        throw std::runtime_error("binary_reader: unknown site id");
+      }
+      const site &s = sites_[id];
+      auto message_level = static_cast<level>(read_byte_());
+      last_time_ += binary::unzigzag(read_varint_());
+      size_t thread_id = read_varint_();
+      read_string_(body_);
+
+      string_view_t payload(body_);
+      if (s.has_format) {
+        payload_.clear();
+        binary::format_args(s.format, s.signature.c_str(), body_, payload_);
+        payload = string_view_t(payload_.data(), payload_.size());
+      }
+      source_location loc(s.has_filename ? s.filename.c_str() : nullptr,
+                          s.line,
+                          s.has_function ? s.function.c_str() : nullptr);
+      auto time = log_clock::time_point(
+          std::chrono::duration_cast<log_clock::duration>(
+              std::chrono::nanoseconds(last_time_)));
+      msg = log_message(names_[s.name_id], message_level, time, loc, payload);
+      msg.thread_id = thread_id;
+      return true;
+    }
+    default:
+      throw std::runtime_error("binary_reader: unknown chunk tag");
+    }
+  }
+}
+
+void binary_reader::read_session_() {
+  // 新会话: 之前的字典和时间基准全部失效
+  char header[sizeof(binary::magic)];
+  header[0] = binary::magic[0];
+  file_.read(header + 1, sizeof(header) - 1);
+  if (file_.gcount() != static_cast<std::streamsize>(sizeof(header) - 1) ||
+      std::memcmp(header, binary::magic, sizeof(header)) != 0) {
+    throw std::runtime_error("binary_reader: bad session header");
+  }
+  names_.clear();
+  sites_.clear();
+  last_time_ = 0;
+}
+
+std::uint8_t binary_reader::read_byte_() {
+  int byte = file_.get();
+  if (byte == std::ifstream::traits_type::eof()) {
+    throw std::runtime_error("binary_reader: truncated file");
+  }
+  return static_cast<std::uint8_t>(byte);
+}
+
+std::uint64_t binary_reader::read_varint_() {
+  std::uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    std::uint8_t byte = read_byte_();
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  throw std::runtime_error("binary_reader: varint too long");
+}
+
+bool binary_reader::read_string_(std::string &out) {
+  std::uint64_t size = read_varint_();
+  out.clear();
+  if (size == 0) {
+    return false;
+  }
+  out.resize(size - 1);
+  file_.read(out.data(), static_cast<std::streamsize>(out.size()));
+  if (file_.gcount() != static_cast<std::streamsize>(out.size())) {
+    throw std::runtime_error("binary_reader: truncated file");
+  }
+  return true;
+}
+} // namespace details
+} // namespace mispdlog
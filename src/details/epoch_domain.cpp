@@ -0,0 +1,122 @@
+#include "mispdlog/details/epoch_domain.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace mispdlog {
+namespace details {
+namespace {
+std::atomic<std::uint64_t> next_domain_id{1};
+
+// 当前线程在各个 epoch_domain 中的槽位
+struct local_slots {
+  struct entry {
+    std::uint64_t domain_id;
+    std::shared_ptr<epoch_domain::reader_slot> slot;
+  };
+  std::vector<entry> entries;
+
+  ~local_slots() {
+    for (const auto &e : entries) {
+      e.slot->in_use.store(false, std::memory_order_release);
+    }
+  }
+};
+
+thread_local local_slots thread_slots;
+} // namespace
+
+epoch_domain::epoch_domain()
+    : id_(next_domain_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+epoch_domain::~epoch_domain() = default;
+
+epoch_domain::guard::guard(epoch_domain &domain)
+    : slot_(&domain.local_slot_()) {
+  if (slot_->depth++ == 0) {
+    slot_->epoch.store(domain.epoch_.load(std::memory_order_seq_cst),
+                       std::memory_order_relaxed);
+    // 与 reclaim 中的 fence 配对: 要么回收者看到这个 epoch,要么之后的读取
+    // 看到写者摘除对象后的新状态
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+epoch_domain::guard::~guard() {
+  if (--slot_->depth == 0) {
+    slot_->epoch.store(0, std::memory_order_release);
+  }
+}
+
+void epoch_domain::retire(std::shared_ptr<const void> object) {
+  if (object == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  // 此后进入的读者 epoch 更大,看到的已是摘除后的状态
+  retired_.emplace_back(epoch_.fetch_add(1, std::memory_order_seq_cst),
+                        std::move(object));
+}
+
+void epoch_domain::reclaim() {
+  std::vector<std::shared_ptr<const void>> expired;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (retired_.empty()) {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+    for (const auto &slot : slots_) {
+      std::uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst);
+      if (epoch != 0) {
+        oldest = std::min(oldest, epoch);
+      }
+    }
+    // 退休 epoch 小于所有活跃读者的对象不可能再被读到
+    auto keep = std::stable_partition(
+        retired_.begin(), retired_.end(),
+        [oldest](const auto &item) { return item.first >= oldest; });
+    for (auto it = keep; it != retired_.end(); ++it) {
+      expired.push_back(std::move(it->second));
+    }
+    retired_.erase(keep, retired_.end());
+  }
+  // 析构(可能关闭文件、join 后台线程)在锁外进行
+  expired.clear();
+}
+
+size_t epoch_domain::retired_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return retired_.size();
+}
+
+epoch_domain::reader_slot &epoch_domain::local_slot_() {
+  auto &entries = thread_slots.entries;
+  for (const auto &e : entries) {
+    if (e.domain_id == id_) {
+      return *e.slot;
+    }
+  }
+  std::shared_ptr<reader_slot> slot;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 优先复用已退出线程的槽位
+    for (const auto &candidate : slots_) {
+      bool in_use = false;
+      if (candidate->in_use.compare_exchange_strong(
+              in_use, true, std::memory_order_acquire)) {
+        slot = candidate;
+        break;
+      }
+    }
+    if (slot == nullptr) {
+      slot = std::make_shared<reader_slot>();
+      slots_.push_back(slot);
+    }
+  }
+  entries.push_back({id_, slot});
+  return *entries.back().slot;
+}
+} // namespace details
+} // namespace mispdlog
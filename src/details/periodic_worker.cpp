@@ -0,0 +1,34 @@
+#include "mispdlog/details/periodic_worker.h"
+
+#include <utility>
+
+namespace mispdlog {
+namespace details {
+periodic_worker::periodic_worker(std::function<void()> callback,
+                                 std::chrono::milliseconds interval) {
+  worker_ = std::thread([this, callback = std::move(callback), interval]() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      if (cv_.wait_for(lock, interval, [this]() { return stop_; })) {
+        return;
+      }
+      // 回调期间不持有锁,析构可以随时请求退出
+      lock.unlock();
+      callback();
+      lock.lock();
+    }
+  });
+}
+
+periodic_worker::~periodic_worker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+} // namespace details
+} // namespace mispdlog
@@ -11,22 +11,29 @@
 namespace mispdlog {
 namespace details {
 
-std::string color(level level, const string_view_t &msg) {
-  std::string color_s =
-      _LOG_IF_HAS_ANSI_COLORS(_k_level_ansi_colors[(std::uint8_t)level] +)
-          msg _LOG_IF_HAS_ANSI_COLORS(+_k_reset_ansi_color);
+std::string color(level level, string_view_t msg) {
+  std::string color_s;
+  _LOG_IF_HAS_ANSI_COLORS(
+      color_s.append(_k_level_ansi_colors[(std::uint8_t)level]);)
+  color_s.append(msg.data(), msg.size());
+  _LOG_IF_HAS_ANSI_COLORS(color_s.append(_k_reset_ansi_color);)
   return color_s;
 }
 
-std::string format_time(const log_clock::time_point &tp, string_view_t format) {
-  std::time_t time_t_val = log_clock::to_time_t(tp);
+std::tm localtime(std::time_t time) noexcept {
   std::tm tm_val;
   // 线程安全的时间转换
 #ifdef _WIN32
-  localtime_s(&tm_val, &time_t_val);
+  localtime_s(&tm_val, &time);
 #else
-  localtime_r(&time_t_val, &tm_val);
+  localtime_r(&time, &tm_val);
 #endif
+  return tm_val;
+}
+
+std::string format_time(const log_clock::time_point &tp,
+                        const std::string &format) {
+  std::tm tm_val = localtime(log_clock::to_time_t(tp));
   std::ostringstream oss;
   oss << std::put_time(&tm_val, format.data());
   return oss.str();
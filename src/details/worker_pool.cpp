@@ -0,0 +1,91 @@
+#include "mispdlog/details/worker_pool.h"
+
+#include <system_error>
+
+namespace mispdlog {
+namespace details {
+worker_pool::worker_pool(size_t threads) : max_threads_(threads) {}
+
+worker_pool::~worker_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &t : threads_) {
+    t.join();
+  }
+}
+
+void worker_pool::run(size_t count, const std::function<void(size_t)> &fn) {
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  bool alone = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count > 1 && threads_.size() < max_threads_) {
+      start_threads_();
+    }
+    // 只有一项或没有线程可用时不唤醒其他线程
+    alone = count <= 1 || threads_.empty();
+    if (alone == false) {
+      fn_ = &fn;
+      count_ = count;
+      next_.store(0, std::memory_order_relaxed);
+      pending_ = threads_.size();
+      batch_++;
+    }
+  }
+  if (alone) {
+    for (size_t i = 0; i < count; i++) {
+      fn(i);
+    }
+    return;
+  }
+  work_cv_.notify_all();
+  work_();
+  // 等所有线程确认本批次结束,fn 才能失效
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() { return pending_ == 0; });
+  fn_ = nullptr;
+}
+
+size_t worker_pool::thread_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return threads_.size();
+}
+
+void worker_pool::start_threads_() {
+  try {
+    while (threads_.size() < max_threads_) {
+      threads_.emplace_back([this]() { worker_loop_(); });
+    }
+  } catch (const std::system_error &) {
+    // 已启动的线程照常使用,其余工作由调用线程完成
+  }
+}
+
+void worker_pool::worker_loop_() {
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [&]() { return stop_ || batch_ != seen; });
+    if (stop_) {
+      return;
+    }
+    seen = batch_;
+    lock.unlock();
+    work_();
+    lock.lock();
+    if (--pending_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+void worker_pool::work_() {
+  for (size_t i = next_++; i < count_; i = next_++) {
+    (*fn_)(i);
+  }
+}
+} // namespace details
+} // namespace mispdlog
@@ -1,6 +1,9 @@
 #include "mispdlog/logger.h"
+#include "mispdlog/details/async_msg.h"
 #include "mispdlog/sinks/base_sink.h"
 #include <algorithm>
+#include <cstdint>
+#include <vector>
 
 namespace mispdlog {
 logger::logger(std::string name) : name_(std::move(name)) {}
@@ -23,32 +26,149 @@ std::vector<sinks::sink_ptr> &logger::sinks() { return sinks_; }
 
 const std::vector<sinks::sink_ptr> &logger::sinks() const { return sinks_; }
 
-void logger::set_level(level level) { level_ = level; }
+void logger::set_level(level level) {
+  level_.store(level, std::memory_order_relaxed);
+}
 
-level logger::get_level() const { return level_; }
+level logger::get_level() const {
+  return level_.load(std::memory_order_relaxed);
+}
 
 bool logger::should_log(level message_level) const {
-  return message_level >= level_;
+  return message_level >= level_.load(std::memory_order_relaxed);
 }
 
-void logger::flush() {
-  for (const auto &sink : sinks_) {
-    sink->flush();
-  }
+bool logger::should_record(level message_level) const {
+  return should_log(message_level) || tracer_.enabled();
 }
 
-void logger::flush_when(level level) { flush_level_ = level; }
+void logger::flush() { flush_(); }
+
+void logger::flush_when(level level) {
+  flush_level_.store(level, std::memory_order_relaxed);
+}
 
 const std::string &logger::name() const { return name_; }
 
+void logger::enable_backtrace(size_t n, level trigger) {
+  tracer_.enable(n, trigger);
+}
+
+void logger::disable_backtrace() { tracer_.disable(); }
+
+void logger::dump_backtrace() {
+  bool dumped = false;
+  // 直接从槽位输出,不搬走 buffer,环无需重新分配
+  tracer_.drain([this, &dumped](const details::async_msg &msg) {
+    if (dumped == false) {
+      sink_it_(details::log_message(name_, level::info,
+                                    "****************** Backtrace Start "
+                                    "******************"));
+      dumped = true;
+    }
+    sink_it_(msg.to_log_message(name_));
+  });
+  if (dumped) {
+    sink_it_(details::log_message(name_, level::info,
+                                  "****************** Backtrace End "
+                                  "********************"));
+  }
+}
+
+void logger::set_deferred_format(bool enabled) {
+  deferred_.store(enabled, std::memory_order_relaxed);
+}
+
+bool logger::deferred_format() const {
+  return deferred_.load(std::memory_order_relaxed);
+}
+
+void logger::log_it_(const details::log_message &message, bool enabled) {
+  if (enabled == false) {
+    // 被过滤的消息只记录到 backtrace 环中
+    tracer_.push(message);
+    return;
+  }
+  if (tracer_.enabled() && message.level >= tracer_.trigger()) {
+    dump_backtrace();
+  }
+  sink_it_(message);
+}
+
 void logger::sink_it_(const details::log_message &message) {
-  for (const auto &sink : sinks_) {
-    if (sink->should_log(message.level)) {
+  fan_out_(message);
+  if (message.level >= flush_level_.load(std::memory_order_relaxed)) {
+    flush_();
+  }
+}
+
+void logger::sink_deferred_(details::async_msg &&record) {
+  memory_buf_t buf;
+  sink_it_(deferred_message_(record, buf));
+}
+
+details::log_message
+logger::deferred_message_(const details::async_msg &record,
+                          memory_buf_t &buf) const {
+  bool render = std::any_of(sinks_.begin(), sinks_.end(),
+                            [](const sinks::sink_ptr &sink) {
+                              return sink->needs_payload();
+                            });
+  if (render) {
+    record.deferred->format(record.payload.data(), record.payload.size(), buf);
+  }
+  details::log_message message(name_, record.level, record.time, record.loc,
+                               string_view_t(buf.data(), buf.size()));
+  message.thread_id = record.thread_id;
+  message.deferred = record.deferred;
+  message.deferred_record =
+      string_view_t(record.payload.data(), record.payload.size());
+  return message;
+}
+
+void logger::fan_out_(const details::log_message &message) {
+  const size_t count = sinks_.size();
+  if (count == 1 || count > 64) {
+    // 单 sink 无需分组; 超过掩码位数时退化为逐个格式化
+    for (const auto &sink : sinks_) {
+      if (sink->should_log(message.level)) {
+        sink->log(message);
+      }
+    }
+    return;
+  }
+
+  std::uint64_t done = 0; // 已处理 sink 的位掩码
+  memory_buf_t buf;
+  for (size_t i = 0; i < count; i++) {
+    const auto &sink = sinks_[i];
+    if (((done >> i) & 1) || sink->should_log(message.level) == false) {
+      continue;
+    }
+    size_t id = sink->formatter_id();
+    if (id == 0) {
       sink->log(message);
+      continue;
+    }
+    // 同一 pattern 只格式化一次,结果分发给后续相同 pattern 的 sink
+    buf.clear();
+    sink->format(message, buf);
+    string_view_t formatted(buf.data(), buf.size());
+    sink->log_formatted(message, formatted);
+    for (size_t j = i + 1; j < count; j++) {
+      const auto &other = sinks_[j];
+      if (((done >> j) & 1) == 0 && other->formatter_id() == id &&
+          other->should_log(message.level)) {
+        other->log_formatted(message, formatted);
+        done |= std::uint64_t(1) << j;
+      }
     }
   }
-  if (message.level >= flush_level_) {
-    flush();
+}
+
+void logger::flush_() {
+  for (const auto &sink : sinks_) {
+    sink->flush();
   }
 }
 
@@ -1,8 +1,15 @@
 #include "mispdlog/pattern_formatter.h"
+#include "mispdlog/details/fmt_helper.h"
+#include "mispdlog/details/utils.h"
 #include "mispdlog/formatter.h"
 #include <chrono>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <utility>
 
 namespace mispdlog {
 // Implementation details would go here
@@ -19,7 +26,7 @@ public:
 
   void format([[maybe_unused]] const details::log_message &msg,
               [[maybe_unused]] const std::tm &tm,
-              fmt::memory_buffer &buf) override {
+              memory_buf_t &buf) override {
     buf.append(str_.data(), str_.data() + str_.size());
   }
 
@@ -38,8 +45,8 @@ private:
 class year_formatter : public pattern_formatter::flag_formatter {
 public:
   void format([[maybe_unused]] const details::log_message &msg,
-              const std::tm &tm, fmt::memory_buffer &buf) override {
-    fmt::format_to(std::back_inserter(buf), "{:04d}", tm.tm_year + 1900);
+              const std::tm &tm, memory_buf_t &buf) override {
+    details::pad4(tm.tm_year + 1900, buf);
   }
   std::unique_ptr<flag_formatter> clone() const override {
     return std::make_unique<year_formatter>();
@@ -53,8 +60,8 @@ public:
 class month_formatter : public pattern_formatter::flag_formatter {
 public:
   void format([[maybe_unused]] const details::log_message &msg,
-              const std::tm &tm, fmt::memory_buffer &buf) override {
-    fmt::format_to(std::back_inserter(buf), "{:02d}", tm.tm_mon + 1);
+              const std::tm &tm, memory_buf_t &buf) override {
+    details::pad2(tm.tm_mon + 1, buf);
   }
   std::unique_ptr<flag_formatter> clone() const override {
     return std::make_unique<month_formatter>();
@@ -69,8 +76,8 @@ public:
 class day_formatter : public pattern_formatter::flag_formatter {
 public:
   void format([[maybe_unused]] const details::log_message &msg,
-              const std::tm &tm, fmt::memory_buffer &buf) override {
-    fmt::format_to(std::back_inserter(buf), "{:02d}", tm.tm_mday);
+              const std::tm &tm, memory_buf_t &buf) override {
+    details::pad2(tm.tm_mday, buf);
   }
   std::unique_ptr<flag_formatter> clone() const override {
     return std::make_unique<day_formatter>();
@@ -85,8 +92,8 @@ public:
 class hour_formatter : public pattern_formatter::flag_formatter {
 public:
   void format([[maybe_unused]] const details::log_message &msg,
-              const std::tm &tm, fmt::memory_buffer &buf) override {
-    fmt::format_to(std::back_inserter(buf), "{:02d}", tm.tm_hour);
+              const std::tm &tm, memory_buf_t &buf) override {
+    details::pad2(tm.tm_hour, buf);
   }
   std::unique_ptr<flag_formatter> clone() const override {
     return std::make_unique<hour_formatter>();
@@ -101,8 +108,8 @@ public:
 class minute_formatter : public pattern_formatter::flag_formatter {
 public:
   void format([[maybe_unused]] const details::log_message &msg,
-              const std::tm &tm, fmt::memory_buffer &buf) override {
-    fmt::format_to(std::back_inserter(buf), "{:02d}", tm.tm_min);
+              const std::tm &tm, memory_buf_t &buf) override {
+    details::pad2(tm.tm_min, buf);
   }
   std::unique_ptr<flag_formatter> clone() const override {
     return std::make_unique<minute_formatter>();
@@ -117,14 +124,68 @@ public:
 class second_formatter : public pattern_formatter::flag_formatter {
 public:
   void format([[maybe_unused]] const details::log_message &msg,
-              const std::tm &tm, fmt::memory_buffer &buf) override {
-    fmt::format_to(std::back_inserter(buf), "{:02d}", tm.tm_sec);
+              const std::tm &tm, memory_buf_t &buf) override {
+    details::pad2(tm.tm_sec, buf);
   }
   std::unique_ptr<flag_formatter> clone() const override {
     return std::make_unique<second_formatter>();
   }
 };
 
+/**
+ * @brief A flag formatter that outputs the milliseconds part of the second
+ * %e - 3 digit milliseconds
+ *
+ */
+class millis_formatter : public pattern_formatter::flag_formatter {
+public:
+  void format(const details::log_message &msg,
+              [[maybe_unused]] const std::tm &tm,
+              memory_buf_t &buf) override {
+    details::pad_uint<3>(
+        details::time_fraction<std::chrono::milliseconds>(msg.time), buf);
+  }
+  std::unique_ptr<flag_formatter> clone() const override {
+    return std::make_unique<millis_formatter>();
+  }
+};
+
+/**
+ * @brief A flag formatter that outputs the microseconds part of the second
+ * %f - 6 digit microseconds
+ *
+ */
+class micros_formatter : public pattern_formatter::flag_formatter {
+public:
+  void format(const details::log_message &msg,
+              [[maybe_unused]] const std::tm &tm,
+              memory_buf_t &buf) override {
+    details::pad_uint<6>(
+        details::time_fraction<std::chrono::microseconds>(msg.time), buf);
+  }
+  std::unique_ptr<flag_formatter> clone() const override {
+    return std::make_unique<micros_formatter>();
+  }
+};
+
+/**
+ * @brief A flag formatter that outputs the nanoseconds part of the second
+ * %F - 9 digit nanoseconds
+ *
+ */
+class nanos_formatter : public pattern_formatter::flag_formatter {
+public:
+  void format(const details::log_message &msg,
+              [[maybe_unused]] const std::tm &tm,
+              memory_buf_t &buf) override {
+    details::pad_uint<9>(
+        details::time_fraction<std::chrono::nanoseconds>(msg.time), buf);
+  }
+  std::unique_ptr<flag_formatter> clone() const override {
+    return std::make_unique<nanos_formatter>();
+  }
+};
+
 /**
  * @brief A flag formatter that outputs the log level
  * %l - log level
@@ -134,7 +195,7 @@ class level_formatter : public pattern_formatter::flag_formatter {
 public:
   void format(const details::log_message &msg,
               [[maybe_unused]] const std::tm &tm,
-              fmt::memory_buffer &buf) override {
+              memory_buf_t &buf) override {
     const char *level_str = level_to_short_string(msg.level);
     buf.append(level_str, level_str + std::strlen(level_str));
   }
@@ -152,7 +213,7 @@ class level_full_formatter : public pattern_formatter::flag_formatter {
 public:
   void format(const details::log_message &msg,
               [[maybe_unused]] const std::tm &tm,
-              fmt::memory_buffer &buf) override {
+              memory_buf_t &buf) override {
     const char *level_str = level_to_string(msg.level);
     buf.append(level_str, level_str + std::strlen(level_str));
   }
@@ -170,7 +231,7 @@ class name_formatter : public pattern_formatter::flag_formatter {
 public:
   void format(const details::log_message &msg,
               [[maybe_unused]] const std::tm &tm,
-              fmt::memory_buffer &buf) override {
+              memory_buf_t &buf) override {
     buf.append(msg.logger_name.data(),
                msg.logger_name.data() + msg.logger_name.size());
   }
@@ -188,7 +249,7 @@ class payload_formatter : public pattern_formatter::flag_formatter {
 public:
   void format(const details::log_message &msg,
               [[maybe_unused]] const std::tm &tm,
-              fmt::memory_buffer &buf) override {
+              memory_buf_t &buf) override {
     buf.append(msg.payload.data(), msg.payload.data() + msg.payload.size());
   }
   std::unique_ptr<flag_formatter> clone() const override {
@@ -205,22 +266,170 @@ class thread_id_formatter : public pattern_formatter::flag_formatter {
 public:
   void format(const details::log_message &msg,
               [[maybe_unused]] const std::tm &tm,
-              fmt::memory_buffer &buf) override {
-    fmt::format_to(std::back_inserter(buf), "{}", msg.thread_id);
+              memory_buf_t &buf) override {
+    details::append_uint(msg.thread_id, buf);
   }
   std::unique_ptr<flag_formatter> clone() const override {
     return std::make_unique<thread_id_formatter>();
   }
 };
+
+/**
+ * @brief A flag formatter that outputs the source file name without directory
+ * %s - basename of __FILE__
+ *
+ */
+class source_filename_formatter : public pattern_formatter::flag_formatter {
+public:
+  void format(const details::log_message &msg,
+              [[maybe_unused]] const std::tm &tm,
+              memory_buf_t &buf) override {
+    if (msg.loc.empty()) {
+      return;
+    }
+    auto base = basenames_.get(msg.loc.filename);
+    buf.append(base.data(), base.data() + base.size());
+  }
+  std::unique_ptr<flag_formatter> clone() const override {
+    return std::make_unique<source_filename_formatter>();
+  }
+
+private:
+  details::basename_cache basenames_;
+};
+
+/**
+ * @brief A flag formatter that outputs the source line
+ * %# - source line
+ *
+ */
+class source_line_formatter : public pattern_formatter::flag_formatter {
+public:
+  void format(const details::log_message &msg,
+              [[maybe_unused]] const std::tm &tm,
+              memory_buf_t &buf) override {
+    if (msg.loc.empty()) {
+      return;
+    }
+    details::append_uint(static_cast<std::uint64_t>(msg.loc.line), buf);
+  }
+  std::unique_ptr<flag_formatter> clone() const override {
+    return std::make_unique<source_line_formatter>();
+  }
+};
+
+/**
+ * @brief A flag formatter that outputs the source function
+ * %! - function name
+ *
+ */
+class source_funcname_formatter : public pattern_formatter::flag_formatter {
+public:
+  void format(const details::log_message &msg,
+              [[maybe_unused]] const std::tm &tm,
+              memory_buf_t &buf) override {
+    if (msg.loc.empty()) {
+      return;
+    }
+    const char *func = msg.loc.function_name;
+    buf.append(func, func + std::strlen(func));
+  }
+  std::unique_ptr<flag_formatter> clone() const override {
+    return std::make_unique<source_funcname_formatter>();
+  }
+};
+
+/**
+ * @brief A flag formatter that outputs file basename and line
+ * %@ - basename:line
+ *
+ */
+class source_location_formatter : public pattern_formatter::flag_formatter {
+public:
+  void format(const details::log_message &msg,
+              [[maybe_unused]] const std::tm &tm,
+              memory_buf_t &buf) override {
+    if (msg.loc.empty()) {
+      return;
+    }
+    auto base = basenames_.get(msg.loc.filename);
+    buf.append(base.data(), base.data() + base.size());
+    buf.push_back(':');
+    details::append_uint(static_cast<std::uint64_t>(msg.loc.line), buf);
+  }
+  std::unique_ptr<flag_formatter> clone() const override {
+    return std::make_unique<source_location_formatter>();
+  }
+
+private:
+  details::basename_cache basenames_;
+};
+
+/**
+ * @brief A contiguous run of time flags (and the text between them), e.g.
+ * "%Y-%m-%d %H:%M:%S"; rendered once per second and then appended as one
+ * memcpy
+ *
+ */
+class cached_time_formatter : public pattern_formatter::flag_formatter {
+public:
+  explicit cached_time_formatter(
+      std::vector<std::unique_ptr<flag_formatter>> parts)
+      : parts_(std::move(parts)) {}
+
+  void format(const details::log_message &msg, const std::tm &tm,
+              memory_buf_t &buf) override {
+    auto secs = std::chrono::duration_cast<std::chrono::seconds>(
+        msg.time.time_since_epoch());
+    if (secs != cached_seconds_) {
+      cached_seconds_ = secs;
+      memory_buf_t rendered;
+      for (auto &part : parts_) {
+        part->format(msg, tm, rendered);
+      }
+      cache_.assign(rendered.data(), rendered.size());
+    }
+    buf.append(cache_.data(), cache_.data() + cache_.size());
+  }
+
+  std::unique_ptr<flag_formatter> clone() const override {
+    std::vector<std::unique_ptr<flag_formatter>> parts;
+    for (const auto &part : parts_) {
+      parts.emplace_back(part->clone());
+    }
+    return std::make_unique<cached_time_formatter>(std::move(parts));
+  }
+
+private:
+  std::vector<std::unique_ptr<flag_formatter>> parts_;
+  std::chrono::seconds cached_seconds_{std::chrono::seconds::min()};
+  std::string cache_;
+};
 } // namespace
 
+// 只在编译 pattern 和设置 formatter 时调用,锁不会出现在日志热路径上
+size_t details::intern_pattern(std::type_index type,
+                               const std::string &pattern) {
+  static std::mutex mutex;
+  static std::map<std::pair<std::type_index, std::string>, size_t> ids;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto key = std::make_pair(type, pattern);
+  auto it = ids.find(key);
+  if (it != ids.end()) {
+    return it->second;
+  }
+  size_t id = ids.size() + 1; // 0 保留给不可共享的 formatter
+  ids.emplace(std::move(key), id);
+  return id;
+}
+
 pattern_formatter::pattern_formatter(const std::string &pattern)
     : pattern_(pattern) {
   compile_pattern();
 }
 
 void pattern_formatter::format(const details::log_message &msg,
-                               fmt::memory_buffer &buf) {
+                               memory_buf_t &buf) {
   // update tm when seconds change
   auto secs = std::chrono::duration_cast<std::chrono::seconds>(
       msg.time.time_since_epoch());
@@ -239,6 +448,14 @@ std::unique_ptr<formatter> pattern_formatter::clone() const {
   return std::make_unique<pattern_formatter>(pattern_);
 }
 
+size_t pattern_formatter::pattern_id() const {
+  // 子类可能改写 format,按动态类型另取 id,不与基类共享
+  if (typeid(*this) == typeid(pattern_formatter)) {
+    return pattern_id_;
+  }
+  return details::intern_pattern(typeid(*this), pattern_);
+}
+
 void pattern_formatter::set_pattern(const std::string &pattern) {
   pattern_ = pattern;
   formatters_.clear();
@@ -246,10 +463,12 @@ void pattern_formatter::set_pattern(const std::string &pattern) {
 }
 
 void pattern_formatter::compile_pattern() {
+  pattern_id_ = details::intern_pattern(typeid(pattern_formatter), pattern_);
   auto it = pattern_.begin();
   auto end = pattern_.end();
   // parse the pattern
   std::string raw_str;
+  std::vector<char> flags; // 与 formatters_ 一一对应, 0 表示原始文本
   while (it != end) {
     if (*it != '%') {
       raw_str.push_back(*it);
@@ -258,6 +477,7 @@ void pattern_formatter::compile_pattern() {
       if (!raw_str.empty()) {
         formatters_.emplace_back(
             std::make_unique<raw_string_formatter>(std::move(raw_str)));
+        flags.push_back(0);
         raw_str.clear();
       }
       ++it; // skip '%'
@@ -284,6 +504,15 @@ void pattern_formatter::compile_pattern() {
         case 'S':
           formatters_.emplace_back(std::make_unique<second_formatter>());
           break;
+        case 'e':
+          formatters_.emplace_back(std::make_unique<millis_formatter>());
+          break;
+        case 'f':
+          formatters_.emplace_back(std::make_unique<micros_formatter>());
+          break;
+        case 'F':
+          formatters_.emplace_back(std::make_unique<nanos_formatter>());
+          break;
         case 'l':
           formatters_.emplace_back(std::make_unique<level_formatter>());
           break;
@@ -299,6 +528,21 @@ void pattern_formatter::compile_pattern() {
         case 't':
           formatters_.emplace_back(std::make_unique<thread_id_formatter>());
           break;
+        case 's':
+          formatters_.emplace_back(
+              std::make_unique<source_filename_formatter>());
+          break;
+        case '#':
+          formatters_.emplace_back(std::make_unique<source_line_formatter>());
+          break;
+        case '!':
+          formatters_.emplace_back(
+              std::make_unique<source_funcname_formatter>());
+          break;
+        case '@':
+          formatters_.emplace_back(
+              std::make_unique<source_location_formatter>());
+          break;
         case '%':
           // escaped '%'
           raw_str.push_back('%');
@@ -309,24 +553,51 @@ void pattern_formatter::compile_pattern() {
           raw_str.push_back(flag);
           break;
         }
+        if (details::is_pattern_flag(flag)) {
+          flags.push_back(flag);
+        }
       }
     }
   } // while
   if (!raw_str.empty()) {
     formatters_.emplace_back(
         std::make_unique<raw_string_formatter>(std::move(raw_str)));
+    flags.push_back(0);
+  }
+  group_time_runs(flags);
+}
+
+void pattern_formatter::group_time_runs(const std::vector<char> &flags) {
+  std::vector<std::unique_ptr<flag_formatter>> grouped;
+  size_t i = 0;
+  while (i < formatters_.size()) {
+    if (details::is_time_flag(flags[i]) == false) {
+      grouped.emplace_back(std::move(formatters_[i]));
+      i++;
+      continue;
+    }
+    // 向后扩展到最后一个时间占位符,中间只允许原始文本
+    size_t last = i;
+    for (size_t k = i + 1; k < formatters_.size(); k++) {
+      if (details::is_time_flag(flags[k])) {
+        last = k;
+      } else if (flags[k] != 0) {
+        break;
+      }
+    }
+    std::vector<std::unique_ptr<flag_formatter>> parts;
+    for (size_t k = i; k <= last; k++) {
+      parts.emplace_back(std::move(formatters_[k]));
+    }
+    grouped.emplace_back(
+        std::make_unique<cached_time_formatter>(std::move(parts)));
+    i = last + 1;
   }
+  formatters_ = std::move(grouped);
 }
 
 std::tm pattern_formatter::get_time(const details::log_message &msg) const {
-  auto in_time_t = log_clock::to_time_t(msg.time);
-  std::tm tm;
-#ifdef _WIN32
-  localtime_s(&tm, &in_time_t);
-#else
-  localtime_r(&in_time_t, &tm);
-#endif
-  return tm;
+  return details::localtime(log_clock::to_time_t(msg.time));
 }
 
 } // namespace mispdlog
\ No newline at end of file
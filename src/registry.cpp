@@ -1,90 +1,501 @@
 #include "mispdlog/registry.h"
+#include "mispdlog/async_logger.h"
+#include "mispdlog/details/periodic_worker.h"
 #include "mispdlog/level.h"
 #include "mispdlog/logger.h"
 #include "mispdlog/sinks/color_console_sink.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fmt/core.h>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace mispdlog {
-registry::registry() { recover_default_(); }
+namespace {
+/**
+ * @brief glob match with '*' (any run, may be empty) and '?' (one char)
+ *
+ */
+bool glob_match(string_view_t glob, string_view_t text) {
+  size_t g = 0;
+  size_t t = 0;
+  size_t star = string_view_t::npos;
+  size_t star_text = 0;
+  while (t < text.size()) {
+    if (g < glob.size() && (glob[g] == '?' || glob[g] == text[t])) {
+      g++;
+      t++;
+    } else if (g < glob.size() && glob[g] == '*') {
+      star = g++;
+      star_text = t;
+    } else if (star != string_view_t::npos) {
+      // 回溯: 让上一个 '*' 多吞一个字符
+      g = star + 1;
+      t = ++star_text;
+    } else {
+      return false;
+    }
+  }
+  while (g < glob.size() && glob[g] == '*') {
+    g++;
+  }
+  return g == glob.size();
+}
+} // namespace
+
+// 默认 logger 在第一次使用时才创建,刷新线程在第一次并行刷新时才启动
+registry::registry() : flush_pool_(flush_pool_size - 1) {}
 
 registry &registry::instance() {
   static registry instance;
   return instance;
 }
 
-void registry::register_logger(std::shared_ptr<logger> logger) {
-  std::lock_guard<std::mutex> lock(mutex_);
+const registry::logger_map::entry *
+registry::logger_map::find(string_view_t name) const {
+  auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), name,
+      [](const entry &lhs, string_view_t rhs) { return lhs.name < rhs; });
+  return it != entries_.end() && it->name == name ? &*it : nullptr;
+}
+
+void registry::logger_map::insert_or_assign(
+    std::shared_ptr<logger> new_logger) {
+  string_view_t name = new_logger->name();
+  auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), name,
+      [](const entry &lhs, string_view_t rhs) { return lhs.name < rhs; });
+  if (it != entries_.end() && it->name == name) {
+    // key 视图指向旧 logger 的名字,需要连同 key 一起替换
+    *it = entry{name, std::move(new_logger)};
+  } else {
+    entries_.insert(it, entry{name, std::move(new_logger)});
+  }
+}
+
+void registry::logger_map::erase(string_view_t name) {
+  auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), name,
+      [](const entry &lhs, string_view_t rhs) { return lhs.name < rhs; });
+  if (it != entries_.end() && it->name == name) {
+    entries_.erase(it);
+  }
+}
+
+template <typename Modify>
+void registry::update_shard_(size_t shard, Modify modify) {
+  auto map = shards_[shard] != nullptr
+                 ? std::make_shared<logger_map>(*shards_[shard])
+                 : std::make_shared<logger_map>();
+  modify(*map);
+  // 先发布新版本再退休旧 map: 之后进入 guard 的读者一定看到新版本
+  std::shared_ptr<const logger_map> old = std::move(shards_[shard]);
+  shards_[shard] = std::move(map);
+  shard_versions_[shard].fetch_add(1, std::memory_order_release);
+  readers_.retire(std::move(old));
+}
+
+template <typename Fn>
+void registry::for_each_matching_(string_view_t glob, Fn fn) {
+  auto wildcard = glob.find_first_of("*?");
+  if (wildcard == string_view_t::npos) {
+    auto it = name_index_.find(glob);
+    if (it != name_index_.end()) {
+      fn(*it->second);
+    }
+    return;
+  }
+  // 通配符前的字面前缀确定有序索引中的区间,区间外的 logger 不会被访问
+  auto prefix = glob.substr(0, wildcard);
+  bool prefix_only = wildcard + 1 == glob.size() && glob[wildcard] == '*';
+  for (auto it = name_index_.lower_bound(prefix);
+       it != name_index_.end() && it->first.substr(0, prefix.size()) == prefix;
+       ++it) {
+    if (prefix_only || glob_match(glob, it->first)) {
+      fn(*it->second);
+    }
+  }
+}
+
+void registry::register_logger_(std::shared_ptr<logger> logger) {
   throw_if_exists_(logger->name());
-  mp_[logger->name()] = logger;
+  apply_level_rules_(*logger);
+  name_index_.emplace(logger->name(), logger.get());
+  update_shard_(shard_of_(logger->name()), [&logger](logger_map &map) {
+    map.insert_or_assign(std::move(logger));
+  });
 }
 
-std::shared_ptr<logger> registry::get(const std::string &logger_name) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto it = mp_.find(logger_name);
-  if (it != mp_.end()) {
-    return it->second;
+void registry::register_logger(std::shared_ptr<logger> logger) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    register_logger_(std::move(logger));
+  }
+  readers_.reclaim();
+}
+
+std::shared_ptr<logger> registry::get(string_view_t logger_name) {
+  details::epoch_domain::guard guard(readers_);
+  const auto *map = snapshot_(shard_of_(logger_name));
+  if (map == nullptr) {
+    return nullptr;
   }
-  return nullptr;
+  const auto *entry = map->find(logger_name);
+  return entry != nullptr ? entry->value : nullptr;
+}
+
+logger *registry::get_raw(string_view_t logger_name) {
+  details::epoch_domain::guard guard(readers_);
+  const auto *map = snapshot_(shard_of_(logger_name));
+  if (map == nullptr) {
+    return nullptr;
+  }
+  const auto *entry = map->find(logger_name);
+  return entry != nullptr ? entry->value.get() : nullptr;
 }
 
 void registry::drop(const std::string &logger_name) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto is_default = default_logger_ && default_logger_->name() == logger_name;
-  mp_.erase(logger_name);
-  if (is_default) {
-    default_logger_.reset();
-    recover_default_();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto is_default =
+        default_logger_ && default_logger_->name() == logger_name;
+    name_index_.erase(logger_name);
+    update_shard_(shard_of_(logger_name), [&logger_name](logger_map &map) {
+      map.erase(logger_name);
+    });
+    if (is_default) {
+      reset_default_();
+    }
   }
+  // 锁外回收: 没有读者正在查找时,logger 在这里析构
+  readers_.reclaim();
 }
 
 void registry::drop_all() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  mp_.clear();
-  default_logger_.reset();
-  recover_default_();
+  std::unique_ptr<details::periodic_worker> flusher;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < shard_count; i++) {
+      if (shards_[i] != nullptr) {
+        std::shared_ptr<const logger_map> old = std::move(shards_[i]);
+        shard_versions_[i].fetch_add(1, std::memory_order_release);
+        readers_.retire(std::move(old));
+      }
+    }
+    name_index_.clear();
+    level_rules_.clear();
+    reset_default_();
+    flusher = std::move(periodic_flusher_);
+  }
+  // 后台线程可能正在等 mutex_,必须在锁外 join
+  flusher.reset();
+  readers_.reclaim();
 }
 
 std::shared_ptr<logger> registry::default_logger() {
   std::lock_guard<std::mutex> lock(mutex_);
+  ensure_default_();
   return default_logger_;
 }
 
+logger *registry::default_logger_raw() {
+  // 只缓存裸指针,不延长旧 logger 的生命周期; 版本一致时它仍是默认 logger
+  thread_local logger *cached = nullptr;
+  thread_local std::uint64_t cached_version = 0;
+  if (cached_version != default_version_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensure_default_();
+    cached = default_logger_.get();
+    cached_version = default_version_.load(std::memory_order_relaxed);
+  }
+  return cached;
+}
+
+registry::pinned_logger::pinned_logger(registry &owner)
+    : guard_(owner.readers_), logger_(owner.default_logger_raw()) {}
+
 void registry::set_default_logger(std::shared_ptr<logger> new_default_logger) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (new_default_logger != nullptr) {
-    mp_[new_default_logger->name()] = new_default_logger;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (new_default_logger != nullptr) {
+      apply_level_rules_(*new_default_logger);
+      name_index_.erase(new_default_logger->name());
+      name_index_.emplace(new_default_logger->name(),
+                          new_default_logger.get());
+      update_shard_(shard_of_(new_default_logger->name()),
+                    [&new_default_logger](logger_map &map) {
+                      map.insert_or_assign(new_default_logger);
+                    });
+    }
+    std::shared_ptr<logger> old = std::move(default_logger_);
+    default_logger_ = std::move(new_default_logger);
+    default_pending_ = false;
+    default_version_.fetch_add(1, std::memory_order_release);
+    readers_.retire(std::move(old));
   }
-  default_logger_ = new_default_logger;
+  readers_.reclaim();
 }
 
 void registry::set_all_level(level level) {
   std::lock_guard<std::mutex> lock(mutex_);
-  default_logger_->set_level(level);
-  for (auto [_, logger] : mp_) {
+  // 覆盖全部层级规则,之后注册的 logger 不再继承旧规则
+  level_rules_.clear();
+  if (default_logger_ != nullptr) {
+    default_logger_->set_level(level);
+  } else {
+    default_level_ = level; // 尚未创建,创建时使用
+  }
+  for (const auto &[_, logger] : name_index_) {
     logger->set_level(level);
   }
 }
 
-void registry::recover_default_() {
+void registry::set_level_matching(string_view_t glob, level level) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for_each_matching_(glob, [level](logger &logger) {
+    logger.set_level(level);
+  });
+}
+
+std::vector<flush_result> registry::flush_matching(string_view_t glob) {
+  std::vector<std::shared_ptr<logger>> loggers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 只为匹配到的 logger 增加引用计数,刷新在锁外进行
+    for_each_matching_(glob, [this, &loggers](logger &logger) {
+      const auto &shard = shards_[shard_of_(logger.name())];
+      loggers.push_back(shard->find(logger.name())->value);
+    });
+  }
+  return flush_loggers_(loggers);
+}
+
+void registry::set_level(const std::string &pattern, level level) {
+  auto star = pattern.find('*');
+  bool subtree = star != std::string::npos;
+  if (subtree && star + 1 != pattern.size()) {
+    throw std::invalid_argument("invalid level pattern '" + pattern + "'");
+  }
+  // "net.*" 以 "net" 为前缀,"*" 匹配全部
+  string_view_t prefix(pattern);
+  if (subtree) {
+    if (pattern.size() > 1 && (star < 2 || pattern[star - 1] != '.')) {
+      throw std::invalid_argument("invalid level pattern '" + pattern + "'");
+    }
+    prefix = prefix.substr(0, pattern.size() > 1 ? star - 1 : 0);
+  }
+  auto matches = [subtree, prefix](string_view_t name) {
+    if (subtree == false) {
+      return name == prefix;
+    }
+    return prefix.empty() ||
+           (name.substr(0, prefix.size()) == prefix &&
+            (name.size() == prefix.size() || name[prefix.size()] == '.'));
+  };
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  level_rules_[pattern] = level;
+  // 只重算被新规则覆盖的 logger,更具体的规则仍然优先
+  for (auto it = name_index_.lower_bound(prefix);
+       it != name_index_.end() && it->first.substr(0, prefix.size()) == prefix;
+       ++it) {
+    if (matches(it->first)) {
+      apply_level_rules_(*it->second);
+    }
+  }
+  // 内置默认 logger 不在 name_index_ 中
+  if (default_logger_ != nullptr && matches(default_logger_->name())) {
+    apply_level_rules_(*default_logger_);
+  }
+}
+
+void registry::apply_level_rules_(logger &logger) const {
+  if (level_rules_.empty()) {
+    return;
+  }
+  const std::string &name = logger.name();
+  auto exact = level_rules_.find(name);
+  if (exact != level_rules_.end()) {
+    logger.set_level(exact->second);
+    return;
+  }
+  // 从最长的祖先前缀向上查找 "xxx.*",最后是 "*"
+  std::string key = name;
+  size_t len = name.size();
+  while (true) {
+    key.assign(name, 0, len);
+    key += len == 0 ? "*" : ".*";
+    auto it = level_rules_.find(key);
+    if (it != level_rules_.end()) {
+      logger.set_level(it->second);
+      return;
+    }
+    if (len == 0) {
+      return;
+    }
+    auto dot = name.rfind('.', len - 1);
+    len = dot == std::string::npos ? 0 : dot;
+  }
+}
+
+void registry::ensure_default_() {
+  if (default_pending_ == false) {
+    return;
+  }
+  // 所有读者都在 ensure 之后才缓存,创建时无需再改版本号
   auto sink = std::make_shared<sinks::color_console_sink_mt>();
   default_logger_ = std::make_shared<logger>("", sink);
-  default_logger_->set_level(level::info);
+  default_logger_->set_level(default_level_);
+  apply_level_rules_(*default_logger_);
+  default_pending_ = false;
 }
 
-void registry::flush_all_loggers() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  default_logger_->flush();
-  for (auto [_, logger] : mp_) {
-    logger->flush();
+void registry::reset_default_() {
+  std::shared_ptr<logger> old = std::move(default_logger_);
+  default_pending_ = true;
+  default_level_ = level::info;
+  default_version_.fetch_add(1, std::memory_order_release);
+  readers_.retire(std::move(old));
+}
+
+void registry::flush_every(std::chrono::milliseconds interval) {
+  std::unique_ptr<details::periodic_worker> flusher;
+  if (interval.count() > 0) {
+    flusher = std::make_unique<details::periodic_worker>(
+        [this]() { periodic_flush_(); }, interval);
   }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(flusher, periodic_flusher_);
+  }
+  // 旧的后台线程在锁外停止
+  flusher.reset();
+}
+
+void registry::periodic_flush_() {
+  for (const auto &result : flush_all_loggers()) {
+    if (result.error.empty() == false) {
+      fmt::print(stderr, "[mispdlog] periodic flush of '{}' error: {}\n",
+                 result.logger_name, result.error);
+    }
+  }
+}
+
+std::vector<std::shared_ptr<logger>> registry::loggers_snapshot_() {
+  std::vector<std::shared_ptr<const logger_map>> shards;
+  std::vector<std::shared_ptr<logger>> loggers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 尚未创建的默认 logger 没有可刷新的内容
+    if (default_logger_ != nullptr) {
+      loggers.push_back(default_logger_);
+    }
+    for (const auto &shard : shards_) {
+      if (shard != nullptr) {
+        shards.push_back(shard);
+      }
+    }
+  }
+  // 已发布的分片不可变,锁外遍历是安全的
+  for (const auto &shard : shards) {
+    for (const auto &[_, logger] : *shard) {
+      if (loggers.empty() || logger != loggers.front()) {
+        loggers.push_back(logger);
+      }
+    }
+  }
+  return loggers;
+}
+
+std::vector<flush_result> registry::flush_all_loggers() {
+  return flush_loggers_(loggers_snapshot_());
+}
+
+std::vector<flush_result>
+registry::flush_loggers_(const std::vector<std::shared_ptr<logger>> &loggers) {
+  // 同步 logger 的 sink 去重后直接刷新,异步 logger 经由自己的队列刷新,
+  // 保证队列中尚未写出的消息也落盘
+  std::vector<flush_result> results;
+  std::vector<std::shared_ptr<logger>> async_owners; // 与 results 一一对应
+  std::unordered_set<sinks::sink *> seen;
+  for (const auto &logger : loggers) {
+    if (dynamic_cast<async_logger *>(logger.get()) != nullptr) {
+      flush_result result;
+      result.logger_name = logger->name();
+      results.push_back(std::move(result));
+      async_owners.push_back(logger);
+      continue;
+    }
+    for (const auto &sink : logger->sinks()) {
+      if (seen.insert(sink.get()).second) {
+        flush_result result;
+        result.logger_name = logger->name();
+        result.sink = sink;
+        results.push_back(std::move(result));
+        async_owners.push_back(nullptr);
+      }
+    }
+  }
+
+  // 常驻线程池与调用线程一起处理,不在每次刷新时创建线程
+  flush_pool_.run(results.size(), [&](size_t i) {
+    auto &result = results[i];
+    auto begin = std::chrono::steady_clock::now();
+    try {
+      if (async_owners[i] != nullptr) {
+        async_owners[i]->flush();
+      } else {
+        result.sink->flush();
+      }
+    } catch (const std::exception &e) {
+      result.error = e.what();
+    } catch (...) {
+      // 运行在线程池中,任何异常都不能逃出 fn
+      result.error = "unknown exception";
+    }
+    result.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - begin);
+  });
+  return results;
 }
 
 void registry::throw_if_exists_(const std::string &logger_name) {
-  if (mp_.find(logger_name) != mp_.end()) {
+  const auto &shard = shards_[shard_of_(logger_name)];
+  if (shard != nullptr && shard->find(logger_name) != nullptr) {
     throw std::runtime_error("logger with name '" + logger_name +
                              "' already exists.");
   }
 }
+
+size_t registry::shard_of_(string_view_t logger_name) {
+  return std::hash<string_view_t>{}(logger_name) % shard_count;
+}
+
+const registry::logger_map *registry::snapshot_(size_t shard) {
+  // 裸指针缓存不持有 map: 版本一致时它仍是当前版本,否则重新读取
+  struct reader_cache {
+    std::array<const logger_map *, shard_count> shards{};
+    std::array<std::uint64_t, shard_count> versions{};
+  };
+  thread_local reader_cache cache;
+  auto version = shard_versions_[shard].load(std::memory_order_acquire);
+  if (cache.versions[shard] != version) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache.shards[shard] = shards_[shard].get();
+    cache.versions[shard] =
+        shard_versions_[shard].load(std::memory_order_relaxed);
+  }
+  return cache.shards[shard];
+}
 } // namespace mispdlog
\ No newline at end of file
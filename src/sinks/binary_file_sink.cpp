@@ -0,0 +1,131 @@
+#include "mispdlog/sinks/binary_file_sink.h"
+#include "mispdlog/details/binary_format.h"
+#include "mispdlog/details/deferred_args.h"
+#include <chrono>
+#include <functional>
+#include <ios>
+#include <stdexcept>
+
+namespace mispdlog {
+namespace sinks {
+template <typename Mutex>
+binary_file_sink<Mutex>::binary_file_sink(const std::string &filename,
+                                          bool truncate) {
+  std::ios::openmode mode = truncate ? std::ios::trunc : std::ios::app;
+  file_.open(filename, std::ios::out | std::ios::binary | mode);
+  if (file_.is_open() == false) {
+    throw std::runtime_error("binary_file_sink: Failed to open file: " +
+                             filename);
+  }
+  // 每次打开都开始新会话,追加写入时读取端据此重置字典
+  file_.write(details::binary::magic, sizeof(details::binary::magic));
+}
+
+template <typename Mutex>
+void binary_file_sink<Mutex>::sink_it_(const details::log_message &message) {
+  using details::binary::put_varint;
+  buf_.clear();
+  std::uint64_t site = site_id_(message, name_id_(message.logger_name));
+
+  auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  message.time.time_since_epoch())
+                  .count();
+  buf_.push_back(static_cast<char>(details::binary::chunk::record));
+  put_varint(site, buf_);
+  buf_.push_back(static_cast<char>(message.level));
+  put_varint(details::binary::zigzag(time - last_time_), buf_);
+  put_varint(message.thread_id, buf_);
+  last_time_ = time;
+
+  if (message.deferred != nullptr) {
+    // 参数先打包到临时 buffer,再带长度前缀写入
+    memory_buf_t args;
+    details::binary::pack_args(message.deferred->signature,
+                               message.deferred_record, args);
+    details::binary::put_string(args.data(), args.size(), buf_);
+  } else {
+    details::binary::put_string(message.payload.data(), message.payload.size(),
+                                buf_);
+  }
+  file_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+}
+
+template <typename Mutex> void binary_file_sink<Mutex>::flush_() {
+  file_.flush();
+}
+
+template <typename Mutex>
+size_t binary_file_sink<Mutex>::site_key_hash::operator()(
+    const site_key &key) const {
+  size_t seed = std::hash<std::uint64_t>()(key.name_id);
+  auto combine = [&seed](size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  };
+  combine(std::hash<const char *>()(key.filename));
+  combine(std::hash<int>()(key.line));
+  combine(std::hash<const char *>()(key.function));
+  combine(std::hash<string_view_t>()(key.format));
+  combine(std::hash<const char *>()(key.signature));
+  return seed;
+}
+
+template <typename Mutex>
+std::uint64_t binary_file_sink<Mutex>::name_id_(string_view_t name) {
+  if (names_.empty() == false && name == last_name_) {
+    return last_name_id_;
+  }
+  auto it = names_.find(name);
+  if (it == names_.end()) {
+    std::uint64_t id = names_.size();
+    it = names_.emplace(std::string(name), id).first;
+    buf_.push_back(static_cast<char>(details::binary::chunk::name));
+    details::binary::put_varint(id, buf_);
+    details::binary::put_string(name.data(), name.size(), buf_);
+  }
+  last_name_ = it->first;
+  last_name_id_ = it->second;
+  return last_name_id_;
+}
+
+template <typename Mutex>
+std::uint64_t
+binary_file_sink<Mutex>::site_id_(const details::log_message &message,
+                                  std::uint64_t name_id) {
+  using details::binary::put_c_string;
+  using details::binary::put_string;
+  string_view_t format;
+  const char *signature = nullptr;
+  if (message.deferred != nullptr) {
+    fmt::string_view text =
+        details::deferred_format_string(message.deferred_record.data());
+    format = string_view_t(text.data(), text.size());
+    signature = message.deferred->signature;
+  }
+  site_key key{name_id,          message.loc.filename,
+               message.loc.line, message.loc.function_name,
+               format,           signature};
+  auto it = sites_.find(key);
+  if (it != sites_.end()) {
+    return it->second;
+  }
+
+  // 格式串可能来自 fmt::runtime() 等临时对象,字典保存自己的副本
+  std::uint64_t id = sites_.size();
+  key.format = site_formats_.emplace_back(format.data(), format.size());
+  sites_.emplace(key, id);
+  const auto &loc = message.loc;
+  buf_.push_back(static_cast<char>(details::binary::chunk::site));
+  details::binary::put_varint(id, buf_);
+  details::binary::put_varint(name_id, buf_);
+  put_c_string(loc.filename, buf_);
+  details::binary::put_varint(static_cast<std::uint64_t>(loc.line), buf_);
+  put_c_string(loc.function_name, buf_);
+  put_string(format.data(), format.size(), buf_);
+  put_c_string(signature, buf_);
+  return id;
+}
+
+template class binary_file_sink<std::mutex>;
+template class binary_file_sink<null_mutex>;
+} // namespace sinks
+} // namespace mispdlog
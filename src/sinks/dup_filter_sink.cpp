@@ -0,0 +1,103 @@
+#include "mispdlog/sinks/dup_filter_sink.h"
+#include <algorithm>
+#include <fmt/format.h>
+#include <functional>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace mispdlog {
+namespace sinks {
+template <typename Mutex>
+dup_filter_sink<Mutex>::dup_filter_sink(
+    std::chrono::milliseconds max_skip_duration)
+    : max_skip_duration_(max_skip_duration) {}
+
+template <typename Mutex>
+dup_filter_sink<Mutex>::dup_filter_sink(
+    std::chrono::milliseconds max_skip_duration, std::vector<sink_ptr> sinks)
+    : sinks_(std::move(sinks)), max_skip_duration_(max_skip_duration) {}
+
+template <typename Mutex> void dup_filter_sink<Mutex>::add_sink(sink_ptr sink) {
+  std::lock_guard<Mutex> lock(this->mutex_);
+  sinks_.emplace_back(std::move(sink));
+}
+
+template <typename Mutex>
+void dup_filter_sink<Mutex>::remove_sink(sink_ptr sink) {
+  std::lock_guard<Mutex> lock(this->mutex_);
+  sinks_.erase(std::remove(sinks_.begin(), sinks_.end(), sink), sinks_.end());
+}
+
+template <typename Mutex>
+void dup_filter_sink<Mutex>::set_formatter(
+    std::unique_ptr<formatter> sink_formatter) {
+  std::lock_guard<Mutex> lock(this->mutex_);
+  for (const auto &sink : sinks_) {
+    sink->set_formatter(sink_formatter->clone());
+  }
+  this->formatter_ = std::move(sink_formatter);
+}
+
+template <typename Mutex>
+void dup_filter_sink<Mutex>::sink_it_(const details::log_message &message) {
+  size_t hash = std::hash<string_view_t>()(message.payload);
+  if (is_duplicate_(message, hash)) {
+    skipped_++;
+    return;
+  }
+  report_skipped_(message.time);
+  forward_(message);
+
+  has_last_ = true;
+  last_hash_ = hash;
+  last_level_ = message.level;
+  last_time_ = message.time;
+  last_payload_.assign(message.payload.data(), message.payload.size());
+  last_logger_name_.assign(message.logger_name.data(),
+                           message.logger_name.size());
+}
+
+template <typename Mutex> void dup_filter_sink<Mutex>::flush_() {
+  report_skipped_(log_clock::now());
+  for (const auto &sink : sinks_) {
+    sink->flush();
+  }
+}
+
+template <typename Mutex>
+bool dup_filter_sink<Mutex>::is_duplicate_(
+    const details::log_message &message, size_t hash) const {
+  // 先比较哈希,相同时才逐字节比较 payload
+  return has_last_ && hash == last_hash_ && message.level == last_level_ &&
+         message.time - last_time_ < max_skip_duration_ &&
+         message.payload == string_view_t(last_payload_);
+}
+
+template <typename Mutex>
+void dup_filter_sink<Mutex>::forward_(const details::log_message &message) {
+  for (const auto &sink : sinks_) {
+    if (sink->should_log(message.level)) {
+      sink->log(message);
+    }
+  }
+}
+
+template <typename Mutex>
+void dup_filter_sink<Mutex>::report_skipped_(log_clock::time_point time) {
+  if (skipped_ == 0) {
+    return;
+  }
+  memory_buf_t buf;
+  fmt::format_to(std::back_inserter(buf), "Skipped {} duplicate messages..",
+                 skipped_);
+  skipped_ = 0;
+  forward_(details::log_message(last_logger_name_, last_level_, time,
+                                details::source_location{},
+                                string_view_t(buf.data(), buf.size())));
+}
+
+template class dup_filter_sink<std::mutex>;
+template class dup_filter_sink<null_mutex>;
+} // namespace sinks
+} // namespace mispdlog
@@ -74,15 +74,22 @@ rotating_file_sink<Mutex>::calc_filename(const std::string &filename,
 
 template <typename Mutex>
 void rotating_file_sink<Mutex>::sink_it_(const details::log_message &message) {
-  fmt::memory_buffer buf;
+  memory_buf_t buf;
   this->format_(message, buf);
-  size_t message_size = buf.size();
+  sink_formatted_(message, string_view_t(buf.data(), buf.size()));
+}
+
+template <typename Mutex>
+void rotating_file_sink<Mutex>::sink_formatted_(
+    [[maybe_unused]] const details::log_message &message,
+    string_view_t formatted) {
+  size_t message_size = formatted.size();
   if (current_size_ + message_size > max_size_) {
     rotate_();
     current_size_ = 0;
   }
   if (file_) {
-    fwrite(buf.data(), 1, buf.size(), file_.get());
+    fwrite(formatted.data(), 1, formatted.size(), file_.get());
     current_size_ += message_size;
   }
 }
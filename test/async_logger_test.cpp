@@ -0,0 +1,482 @@
+#define ANKERL_NANOBENCH_IMPLEMENT
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "mispdlog/async_logger.h"
+#include "mispdlog/level.h"
+#include "mispdlog/mispdlog.h"
+#include "mispdlog/sinks/base_sink.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <doctest.h>
+#include <fstream>
+#include <memory>
+#include <nanobench.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mispdlog;
+
+/**
+ * @brief 模拟磁盘卡顿的 sink: 每条消息睡眠一段时间
+ *
+ */
+template <typename Mutex> class slow_sink : public sinks::base_sink<Mutex> {
+public:
+  explicit slow_sink(std::chrono::microseconds delay) : delay_(delay) {}
+
+  size_t count() const { return count_.load(); }
+
+protected:
+  void sink_it_(const details::log_message &) override {
+    std::this_thread::sleep_for(delay_);
+    count_++;
+  }
+
+  void flush_() override {}
+
+private:
+  std::chrono::microseconds delay_;
+  std::atomic<size_t> count_{0};
+};
+
+/**
+ * @brief 记录每条消息的 payload
+ *
+ */
+template <typename Mutex> class payload_sink : public sinks::base_sink<Mutex> {
+public:
+  std::vector<std::string> payloads() {
+    std::lock_guard<Mutex> lock(this->mutex_);
+    return payloads_;
+  }
+
+protected:
+  void sink_it_(const details::log_message &msg) override {
+    payloads_.emplace_back(msg.payload.data(), msg.payload.size());
+  }
+
+  void flush_() override {}
+
+private:
+  std::vector<std::string> payloads_;
+};
+
+/**
+ * @brief 记录 flush 是否都在写消息的后台线程上执行
+ *
+ */
+template <typename Mutex> class thread_sink : public sinks::base_sink<Mutex> {
+public:
+  bool flushed_off_worker() const { return flushed_off_worker_.load(); }
+  size_t flushes() const { return flushes_.load(); }
+
+protected:
+  void sink_it_(const details::log_message &) override {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    worker_ = std::this_thread::get_id();
+  }
+
+  void flush_() override {
+    if (worker_ != std::thread::id() &&
+        worker_ != std::this_thread::get_id()) {
+      flushed_off_worker_ = true;
+    }
+    flushes_++;
+  }
+
+private:
+  std::thread::id worker_;
+  std::atomic<bool> flushed_off_worker_{false};
+  std::atomic<size_t> flushes_{0};
+};
+
+struct point {
+  int x;
+  int y;
+};
+
+template <> struct fmt::formatter<point> : fmt::formatter<int> {
+  template <typename FormatContext>
+  auto format(const point &p, FormatContext &ctx) const {
+    return fmt::format_to(ctx.out(), "({}, {})", p.x, p.y);
+  }
+};
+
+static size_t count_lines(const std::string &filename) {
+  std::ifstream f(filename);
+  size_t lines = 0;
+  std::string line;
+  while (std::getline(f, line)) {
+    lines++;
+  }
+  return lines;
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_mpsc_queue") {
+  std::cout << "\n========== 测试1:无锁队列 ==========\n";
+  details::mpsc_queue<int> queue(5);
+  CHECK_EQ(queue.capacity(), 8); // 向上取 2 的幂
+
+  for (int i = 0; i < 8; i++) {
+    CHECK(queue.try_enqueue(i));
+  }
+  CHECK_FALSE(queue.try_enqueue(8)); // 满
+  CHECK_EQ(queue.size_approx(), 8);
+
+  int value = -1;
+  for (int i = 0; i < 8; i++) {
+    CHECK(queue.try_dequeue(value));
+    CHECK_EQ(value, i); // FIFO
+  }
+  CHECK_FALSE(queue.try_dequeue(value)); // 空
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_basic") {
+  std::cout << "\n========== 测试2:异步文件日志 ==========\n";
+  auto log = async_basic_logger_mt("async_basic", "logs/async_basic.log", true);
+  for (int i = 0; i < 100; i++) {
+    log->info("async message {}", i);
+  }
+  log->flush(); // 等待后台线程写完并刷新
+  CHECK_EQ(count_lines("logs/async_basic.log"), 100);
+  drop("async_basic");
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_multithread_block") {
+  std::cout << "\n========== 测试3:多线程 block 策略 ==========\n";
+  auto sink = std::make_shared<slow_sink<std::mutex>>(
+      std::chrono::microseconds(0));
+  auto log = std::make_shared<async_logger>("async_block", sink, 64,
+                                            async_overflow_policy::block);
+  const int threads = 4;
+  const int per_thread = 2000;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&log, t]() {
+      for (int i = 0; i < per_thread; i++) {
+        log->info("thread {} message {}", t, i);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  log->flush();
+  CHECK_EQ(sink->count(), threads * per_thread); // block 策略不丢消息
+  CHECK_EQ(log->dropped_count(), 0);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_overflow_policy") {
+  std::cout << "\n========== 测试4:溢出策略 ==========\n";
+  for (auto policy : {async_overflow_policy::discard_new,
+                      async_overflow_policy::overrun_oldest}) {
+    auto sink = std::make_shared<slow_sink<std::mutex>>(
+        std::chrono::microseconds(200));
+    size_t total = 0;
+    size_t dropped = 0;
+    {
+      async_logger log("async_overflow", sink, 16, policy);
+      for (int i = 0; i < 1000; i++) {
+        log.info("overflow message {}", i);
+      }
+      log.flush(); // 即使 flush 请求被覆盖也必须返回
+      dropped = log.dropped_count();
+    }
+    total = sink->count();
+    std::cout << "写入: " << total << " 丢弃: " << dropped << "\n";
+    CHECK_GT(dropped, 0);
+    CHECK_EQ(total + dropped, 1000);
+  }
+
+  // 被覆盖的 flush 请求放回队列,仍由后台线程完成; 标记可能乱序处理,
+  // 每个 flush 只在自己的标记处理后返回
+  auto flush_sink = std::make_shared<thread_sink<std::mutex>>();
+  {
+    async_logger log("async_overrun_flush", flush_sink, 4,
+                     async_overflow_policy::overrun_oldest);
+    std::atomic<bool> done{false};
+    std::thread producer([&]() {
+      while (done.load() == false) {
+        log.info("spam");
+      }
+    });
+    constexpr int flushers = 4;
+    constexpr int rounds = 20;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < flushers; t++) {
+      threads.emplace_back([&]() {
+        for (int i = 0; i < rounds; i++) {
+          log.flush();
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    // 在析构前检查: 所有 flush 返回时,每个标记都已由后台处理
+    CHECK_GE(flush_sink->flushes(), flushers * rounds);
+    done = true;
+    producer.join();
+  }
+  CHECK_FALSE(flush_sink->flushed_off_worker());
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_destructor_drains") {
+  std::cout << "\n========== 测试5:析构时排空队列 ==========\n";
+  auto sink = std::make_shared<slow_sink<std::mutex>>(
+      std::chrono::microseconds(10));
+  {
+    async_logger log("async_drain", sink, 1024);
+    for (int i = 0; i < 500; i++) {
+      log.info("drain message {}", i);
+    }
+  }
+  CHECK_EQ(sink->count(), 500);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_performance") {
+  std::cout << "\n========== 测试6:磁盘卡顿时的生产者延迟 ==========\n";
+  CHECK_NOTHROW(
+      auto sync_sink = std::make_shared<slow_sink<std::mutex>>(
+          std::chrono::microseconds(50));
+      auto async_sink = std::make_shared<slow_sink<std::mutex>>(
+          std::chrono::microseconds(50));
+      logger sync_logger("sync_perf", sync_sink);
+      async_logger async_log("async_perf", async_sink, 8192,
+                             async_overflow_policy::discard_new);
+
+      ankerl::nanobench::Bench bench; bench.minEpochIterations(2000);
+      bench.run("sync logger, stalled sink",
+                [&]() { sync_logger.info("Performance test message {}", 42); });
+      bench.minEpochIterations(200000);
+      bench.run("async logger (discard_new), stalled sink",
+                [&]() { async_log.info("Performance test message {}", 42); });
+      std::cout << "async 丢弃: " << async_log.dropped_count() << "\n";);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_deferred_format") {
+  std::cout << "\n========== 测试7:延迟格式化 ==========\n";
+  static_assert(details::is_deferrable_v<int, double, const char *,
+                                         std::string, std::string_view>);
+  static_assert(details::is_deferrable_v<const char(&)[4], std::string &>);
+  static_assert(details::is_deferrable_v<point> == false);
+
+  auto sink = std::make_shared<payload_sink<std::mutex>>();
+  {
+    async_logger log("async_deferred", sink);
+    log.set_deferred_format(true);
+    CHECK(log.deferred_format());
+
+    std::string text = "owned";
+    const char *null_text = nullptr;
+    char buffer[] = "array";
+    log.info("int {} double {:.3f} char {} bool {}", -42, 3.14159, 'c', true);
+    log.info("c string {} {} {}", "literal", buffer, null_text == nullptr);
+    log.info("string {} view {}", text, std::string_view(text).substr(1, 3));
+    log.info("custom {} falls back", point{1, 2});
+    {
+      // 运行时格式串在调用返回后被改写并销毁,记录里保存的是副本
+      std::string runtime_fmt = "runtime {} format";
+      log.info(fmt::runtime(runtime_fmt), 7);
+      runtime_fmt.assign(runtime_fmt.size(), 'x');
+    }
+    log.info(std::string("temporary {}"), 8);
+    log.info("no args");
+    log.debug("level {}", "debug");
+    log.set_level(level::info);
+    log.debug("filtered {}", 1);
+    text = "changed"; // 入队后修改参数不影响输出
+    buffer[0] = 'X';
+  }
+  std::vector<std::string> expected{
+      fmt::format("int {} double {:.3f} char {} bool {}", -42, 3.14159, 'c',
+                  true),
+      "c string literal array true",
+      "string owned view wne",
+      "custom (1, 2) falls back",
+      "runtime 7 format",
+      "temporary 8",
+      "no args",
+      "level debug"};
+  CHECK_EQ(sink->payloads(), expected);
+
+  // 同步 logger 在调用线程立即渲染记录
+  auto sync_sink = std::make_shared<payload_sink<std::mutex>>();
+  logger sync_log("sync_deferred", sync_sink);
+  sync_log.set_deferred_format(true);
+  sync_log.info("int {} double {:.3f} char {} bool {}", -42, 3.14159, 'c',
+                true);
+  CHECK_EQ(sync_sink->payloads(), std::vector<std::string>{expected[0]});
+
+  // 调用方开销: 延迟格式化只拷贝参数
+  auto perf_sink = std::make_shared<payload_sink<std::mutex>>();
+  CHECK_NOTHROW(
+      async_logger eager_log("async_eager_perf", perf_sink, 8192,
+                             async_overflow_policy::discard_new);
+      async_logger deferred_log("async_deferred_perf", perf_sink, 8192,
+                                async_overflow_policy::discard_new);
+      deferred_log.set_deferred_format(true); ankerl::nanobench::Bench bench;
+      bench.minEpochIterations(200000);
+      bench.run("async logger, eager format",
+                [&]() {
+                  eager_log.info("request {} took {:.2f} ms from {}", 42, 1.5,
+                                 "127.0.0.1");
+                });
+      bench.run("async logger, deferred format", [&]() {
+        deferred_log.info("request {} took {:.2f} ms from {}", 42, 1.5,
+                          "127.0.0.1");
+      }););
+}
+
+namespace {
+/**
+ * @brief 记录每条消息的 payload 和时间
+ *
+ */
+class timed_sink : public sinks::base_sink<std::mutex> {
+public:
+  struct record {
+    std::string payload;
+    log_clock::time_point time;
+  };
+
+  std::vector<record> records() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+  }
+
+protected:
+  void sink_it_(const details::log_message &msg) override {
+    records_.push_back({std::string(msg.payload), msg.time});
+  }
+
+  void flush_() override {}
+
+private:
+  std::vector<record> records_;
+};
+} // namespace
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_per_thread_rings") {
+  std::cout << "\n========== 测试8:每线程 SPSC 环与时间归并 ==========\n";
+  CHECK_THROWS_AS(async_logger("bad_mode", std::make_shared<timed_sink>(), 64,
+                               async_overflow_policy::overrun_oldest,
+                               async_queue_mode::per_thread),
+                  std::invalid_argument);
+
+  constexpr int threads = 8;
+  constexpr int per_thread = 2000;
+  auto sink = std::make_shared<timed_sink>();
+  {
+    async_logger log("per_thread", sink, async_logger::default_queue_size,
+                     async_overflow_policy::block,
+                     async_queue_mode::per_thread, 256);
+    CHECK_EQ(log.queue_mode(), async_queue_mode::per_thread);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&log, t]() {
+        for (int i = 0; i < per_thread; i++) {
+          log.info("{} {}", t, i);
+        }
+      });
+    }
+    for (auto &w : workers) {
+      w.join();
+    }
+    // 生产线程都已退出,flush 仍要看到它们的全部消息
+    log.flush();
+    CHECK_EQ(sink->records().size(), threads * per_thread);
+  }
+
+  auto records = sink->records();
+  REQUIRE_EQ(records.size(), threads * per_thread);
+  std::vector<int> next(threads, 0);
+  bool in_order = true;
+  size_t inversions = 0;
+  for (size_t i = 0; i < records.size(); i++) {
+    int t = 0;
+    int seq = 0;
+    std::sscanf(records[i].payload.c_str(), "%d %d", &t, &seq);
+    in_order = in_order && seq == next[t];
+    next[t] = seq + 1;
+    if (i > 0 && records[i].time < records[i - 1].time) {
+      inversions++;
+    }
+  }
+  // 每个线程的消息完整且保持 FIFO; 跨线程顺序取决于调度,只输出不断言
+  CHECK(in_order);
+  CHECK_EQ(next, std::vector<int>(threads, per_thread));
+  std::cout << "跨线程时间逆序: " << inversions << " / " << records.size()
+            << "\n";
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_per_thread_teardown") {
+  std::cout << "\n========== 测试9:线程与 logger 退出时回收环 ==========\n";
+  auto sink = std::make_shared<timed_sink>();
+  {
+    async_logger log("teardown", sink, async_logger::default_queue_size,
+                     async_overflow_policy::block,
+                     async_queue_mode::per_thread, 64);
+    // 128 个短命线程,各自的环在线程退出后由后台排空回收
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 128; t++) {
+      workers.emplace_back([&log, t]() {
+        for (int i = 0; i < 10; i++) {
+          log.info("thread {} message {}", t, i);
+        }
+      });
+    }
+    for (auto &w : workers) {
+      w.join();
+    }
+    log.flush();
+  }
+  CHECK_EQ(sink->records().size(), 1280);
+
+  // 同一线程先后使用多个 logger: 旧 logger 的环被标记并清理
+  for (int round = 0; round < 3; round++) {
+    auto round_sink = std::make_shared<timed_sink>();
+    {
+      async_logger log("teardown_round", round_sink,
+                       async_logger::default_queue_size,
+                       async_overflow_policy::block,
+                       async_queue_mode::per_thread, 16);
+      for (int i = 0; i < 100; i++) {
+        log.info("round {} message {}", round, i);
+      }
+    }
+    CHECK_EQ(round_sink->records().size(), 100);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_async_per_thread_performance") {
+  std::cout << "\n========== 测试10:共享队列与每线程环的生产者开销 ==========\n";
+  CHECK_NOTHROW(
+      auto shared_sink = std::make_shared<timed_sink>();
+      auto ring_sink = std::make_shared<timed_sink>();
+      async_logger shared_log("shared_perf", shared_sink, 8192,
+                              async_overflow_policy::discard_new);
+      async_logger ring_log("ring_perf", ring_sink, 8192,
+                            async_overflow_policy::discard_new,
+                            async_queue_mode::per_thread, 8192);
+      shared_log.set_deferred_format(true); ring_log.set_deferred_format(true);
+      ankerl::nanobench::Bench bench; bench.minEpochIterations(200000);
+      bench.run("shared MPSC queue",
+                [&]() { shared_log.info("request {} from {}", 42, "host"); });
+      bench.run("per-thread SPSC ring",
+                [&]() { ring_log.info("request {} from {}", 42, "host"); }););
+}
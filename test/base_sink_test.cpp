@@ -43,6 +43,22 @@ TEST_CASE("test source location simple") {
                 << "\n";);
 }
 // NOLINTNEXTLINE
+TEST_CASE("test log_message zero copy") {
+  std::cout << "\n========== 测试:log_msg 零拷贝 ==========\n";
+  std::string name = "ViewLogger";
+  memory_buf_t buf;
+  fmt::format_to(std::back_inserter(buf), "payload {}", 42);
+  details::log_message msg(name, level::info,
+                           string_view_t(buf.data(), buf.size()));
+  // 视图直接指向 logger 名称和调用方 buffer,没有发生拷贝
+  CHECK_EQ(msg.logger_name.data(), name.data());
+  CHECK_EQ(msg.payload.data(), buf.data());
+  CHECK_EQ(msg.payload, "payload 42");
+
+  details::log_message copied = msg;
+  CHECK_EQ(copied.payload.data(), buf.data());
+}
+// NOLINTNEXTLINE
 TEST_CASE("test multi-thread console sink") {
   std::cout << "\n========== 测试3:多线程控制台 Sink ==========\n";
   CHECK_NOTHROW(auto sink = std::make_shared<sinks::console_sink_mt>();
@@ -3,17 +3,64 @@
 
 #include "mispdlog/level.h"
 #include "mispdlog/logger.h"
+#include "mispdlog/mispdlog.h"
 #include "mispdlog/sinks/color_console_sink.h"
 #include "mispdlog/sinks/console_sink.h"
 #include "mispdlog/sinks/file_sink.h"
 
 #include <doctest.h>
 #include <memory>
+#include <mutex>
 #include <nanobench.h>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 using namespace mispdlog;
 
+namespace {
+// 统计拷贝与移动次数
+struct copy_counter {
+  static int copies;
+  static int moves;
+  int value{0};
+
+  explicit copy_counter(int v) : value(v) {}
+  copy_counter(const copy_counter &other) : value(other.value) { copies++; }
+  copy_counter(copy_counter &&other) noexcept : value(other.value) {
+    moves++;
+  }
+  copy_counter &operator=(const copy_counter &) = delete;
+  copy_counter &operator=(copy_counter &&) = delete;
+};
+int copy_counter::copies = 0;
+int copy_counter::moves = 0;
+
+// 只能移动的参数
+struct move_only {
+  int value{0};
+
+  explicit move_only(int v) : value(v) {}
+  move_only(const move_only &) = delete;
+  move_only(move_only &&) = default;
+};
+} // namespace
+
+template <> struct fmt::formatter<copy_counter> : fmt::formatter<int> {
+  template <typename FormatContext>
+  auto format(const copy_counter &c, FormatContext &ctx) const {
+    return fmt::formatter<int>::format(c.value, ctx);
+  }
+};
+
+template <> struct fmt::formatter<move_only> : fmt::formatter<int> {
+  template <typename FormatContext>
+  auto format(const move_only &m, FormatContext &ctx) const {
+    return fmt::formatter<int>::format(m.value, ctx);
+  }
+};
+
 // NOLINTNEXTLINE
 TEST_CASE("test_basic_logging") {
   std::cout << "\n========== 测试1:基础日志接口 ==========\n";
@@ -276,4 +323,342 @@ TEST_CASE("test_real_world_example") {
       std::cout << "\n 查看 3 个文件的内容:\n";
       std::cout << "  - logs/application.log (debug及以上)\n";
       std::cout << "  - logs/errors.log (error及以上)\n";);
-}
\ No newline at end of file
+}
+/**
+ * @brief 统计 format 调用次数的 formatter
+ *
+ */
+class counting_formatter : public pattern_formatter {
+public:
+  using pattern_formatter::pattern_formatter;
+
+  void format(const details::log_message &msg, memory_buf_t &buf) override {
+    calls++;
+    pattern_formatter::format(msg, buf);
+  }
+
+  static inline int calls = 0;
+};
+
+// pattern 相同但输出不同的 formatter
+class tagged_formatter : public pattern_formatter {
+public:
+  using pattern_formatter::pattern_formatter;
+
+  void format(const details::log_message &msg, memory_buf_t &buf) override {
+    buf.append(string_view_t("tagged "));
+    pattern_formatter::format(msg, buf);
+  }
+
+  std::unique_ptr<formatter> clone() const override {
+    return std::make_unique<tagged_formatter>("[%n] %v");
+  }
+};
+
+// 只实现 sink_it_,自己格式化
+class format_sink : public sinks::base_sink<std::mutex> {
+public:
+  std::vector<std::string> lines;
+
+protected:
+  void sink_it_(const details::log_message &msg) override {
+    memory_buf_t buf;
+    this->format_(msg, buf);
+    lines.emplace_back(buf.data(), buf.size());
+  }
+  void flush_() override {}
+};
+
+// 不经过 base_sink,只实现 sink 的必需接口
+class plain_sink : public sinks::sink {
+public:
+  size_t count{0};
+
+  void log(const details::log_message &) override { count++; }
+  void flush() override {}
+  void set_level(level) override {}
+  level get_level() const override { return level::trace; }
+  bool should_log(level) const override { return true; }
+  void set_formatter(std::unique_ptr<formatter>) override {}
+};
+
+// NOLINTNEXTLINE
+TEST_CASE("test_format_once_fan_out") {
+  std::cout << "\n========== 测试14:多 Sink 共享格式化结果 ==========\n";
+  auto file_sink1 =
+      std::make_shared<sinks::file_sink_mt>("logs/fan_out_1.log", true);
+  auto file_sink2 =
+      std::make_shared<sinks::file_sink_mt>("logs/fan_out_2.log", true);
+  auto console_sink = std::make_shared<sinks::console_sink_mt>();
+  file_sink1->set_formatter(std::make_unique<counting_formatter>("[%n] %v"));
+  file_sink2->set_formatter(std::make_unique<counting_formatter>("[%n] %v"));
+  console_sink->set_formatter(
+      std::make_unique<counting_formatter>("[%l] [%n] %v"));
+  CHECK_EQ(file_sink1->formatter_id(), file_sink2->formatter_id());
+  CHECK_NE(file_sink1->formatter_id(), console_sink->formatter_id());
+
+  logger my_logger("FanOutLogger",
+                   std::vector<sinks::sink_ptr>{file_sink1, console_sink,
+                                                file_sink2});
+  counting_formatter::calls = 0;
+  my_logger.info("shared rendering");
+  // 两个相同 pattern 的文件 sink 只格式化一次,控制台单独一次
+  CHECK_EQ(counting_formatter::calls, 2);
+  my_logger.flush();
+
+  std::ifstream f1("logs/fan_out_1.log");
+  std::ifstream f2("logs/fan_out_2.log");
+  std::string line1, line2;
+  std::getline(f1, line1);
+  std::getline(f2, line2);
+  CHECK_EQ(line1, "[FanOutLogger] shared rendering");
+  CHECK_EQ(line1, line2);
+
+  // 只实现 sink_it_ 的用户 sink 不参与共享,每条消息只格式化一次
+  auto custom = std::make_shared<format_sink>();
+  custom->set_formatter(std::make_unique<counting_formatter>("[%n] %v"));
+  CHECK_EQ(custom->formatter_id(), 0);
+  logger mixed_logger("MixedLogger",
+                      std::vector<sinks::sink_ptr>{custom, file_sink1});
+  counting_formatter::calls = 0;
+  mixed_logger.info("own rendering");
+  CHECK_EQ(counting_formatter::calls, 2);
+  REQUIRE_EQ(custom->lines.size(), 1);
+  CHECK_EQ(custom->lines[0], "[MixedLogger] own rendering\n");
+
+  // pattern 文本相同但 formatter 类型不同,不共享渲染结果
+  auto tagged_sink =
+      std::make_shared<sinks::file_sink_mt>("logs/fan_out_tagged.log", true);
+  tagged_sink->set_formatter(std::make_unique<tagged_formatter>("[%n] %v"));
+  CHECK_NE(tagged_sink->formatter_id(), file_sink1->formatter_id());
+  CHECK_NE(tagged_sink->formatter_id(), 0);
+  auto untagged_sink =
+      std::make_shared<sinks::file_sink_mt>("logs/fan_out_untagged.log", true);
+  untagged_sink->set_formatter(std::make_unique<pattern_formatter>("[%n] %v"));
+  CHECK_NE(untagged_sink->formatter_id(), tagged_sink->formatter_id());
+  logger typed_logger("TypedLogger",
+                      std::vector<sinks::sink_ptr>{untagged_sink, tagged_sink});
+  typed_logger.info("typed");
+  typed_logger.flush();
+  std::ifstream tagged_file("logs/fan_out_tagged.log");
+  std::ifstream untagged_file("logs/fan_out_untagged.log");
+  std::string tagged_line, untagged_line;
+  std::getline(tagged_file, tagged_line);
+  std::getline(untagged_file, untagged_line);
+  CHECK_EQ(tagged_line, "tagged [TypedLogger] typed");
+  CHECK_EQ(untagged_line, "[TypedLogger] typed");
+
+  // 直接实现 sink 接口的旧代码无需实现新增的虚函数
+  auto plain = std::make_shared<plain_sink>();
+  logger plain_logger("PlainLogger",
+                      std::vector<sinks::sink_ptr>{plain, file_sink1});
+  plain_logger.info("plain");
+  CHECK_EQ(plain->count, 1);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_concurrent_level_change") {
+  std::cout << "\n========== 测试15:运行时并发修改级别 ==========\n";
+  auto sink = std::make_shared<sinks::file_sink_mt>("logs/level_change.log",
+                                                    true);
+  logger my_logger("LevelChangeLogger", sink);
+  std::atomic<bool> running{true};
+
+  // 管理线程反复修改 logger 和 sink 的级别
+  std::thread admin([&]() {
+    for (int i = 0; i < 1000; i++) {
+      my_logger.set_level(i % 2 ? level::debug : level::warn);
+      sink->set_level(i % 2 ? level::trace : level::error);
+    }
+    running = false;
+  });
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; t++) {
+    workers.emplace_back([&]() {
+      while (running) {
+        my_logger.debug("debug while levels change");
+        my_logger.error("error while levels change");
+      }
+    });
+  }
+  admin.join();
+  for (auto &w : workers) {
+    w.join();
+  }
+  my_logger.set_level(level::info);
+  sink->set_level(level::warn);
+  CHECK_EQ(my_logger.get_level(), level::info);
+  CHECK_EQ(sink->get_level(), level::warn);
+  CHECK_FALSE(my_logger.should_log(level::debug));
+  CHECK_FALSE(sink->should_log(level::info));
+}
+
+namespace {
+// 按顺序记录收到的消息内容
+class collect_sink : public sinks::base_sink<std::mutex> {
+public:
+  std::vector<std::string> payloads;
+
+protected:
+  void sink_it_(const details::log_message &msg) override {
+    payloads.emplace_back(msg.payload);
+  }
+  void flush_() override {}
+};
+} // namespace
+
+// NOLINTNEXTLINE
+TEST_CASE("test_backtrace") {
+  std::cout << "\n========== 测试16:Backtrace 环形缓冲 ==========\n";
+  auto sink = std::make_shared<collect_sink>();
+  logger my_logger("BacktraceLogger", sink);
+  my_logger.set_level(level::info);
+  my_logger.enable_backtrace(3);
+
+  for (int i = 0; i < 5; i++) {
+    my_logger.debug("debug {}", i);
+  }
+  my_logger.info("info");
+  // 被过滤的消息不会输出
+  REQUIRE_EQ(sink->payloads.size(), 1);
+
+  // error 触发: 先输出最近 3 条被过滤的消息
+  my_logger.error("boom");
+  REQUIRE_EQ(sink->payloads.size(), 7);
+  CHECK_EQ(sink->payloads[2], "debug 2");
+  CHECK_EQ(sink->payloads[3], "debug 3");
+  CHECK_EQ(sink->payloads[4], "debug 4");
+  CHECK_EQ(sink->payloads[6], "boom");
+
+  // 已输出的内容被清空,再次触发不会重复
+  my_logger.error("boom again");
+  CHECK_EQ(sink->payloads.size(), 8);
+
+  // 手动输出
+  my_logger.trace("trace context");
+  my_logger.dump_backtrace();
+  REQUIRE_EQ(sink->payloads.size(), 11);
+  CHECK_EQ(sink->payloads[9], "trace context");
+
+  my_logger.disable_backtrace();
+  my_logger.debug("dropped");
+  my_logger.dump_backtrace();
+  CHECK_EQ(sink->payloads.size(), 11);
+
+  // 记录一条被过滤的消息与完整输出一条消息的开销对比
+  auto file_sink =
+      std::make_shared<sinks::file_sink_mt>("logs/backtrace.log", true);
+  logger bench_logger("BacktraceBench", file_sink);
+  bench_logger.set_level(level::info);
+  bench_logger.enable_backtrace(128);
+  ankerl::nanobench::Bench bench;
+  bench.title("backtrace").minEpochIterations(100000);
+  bench.run("debug() recorded to backtrace",
+            [&]() { bench_logger.debug("value {} {}", 42, "text"); });
+  bench.run("info() through sink",
+            [&]() { bench_logger.info("value {} {}", 42, "text"); });
+}
+
+namespace {
+// 只计数,衡量 logger 自身的开销
+class count_sink : public sinks::base_sink<sinks::null_mutex> {
+public:
+  size_t count{0};
+  size_t bytes{0};
+
+protected:
+  void sink_it_(const details::log_message &msg) override {
+    count++;
+    bytes += msg.payload.size();
+  }
+  void flush_() override {}
+};
+} // namespace
+
+// NOLINTNEXTLINE
+TEST_CASE("test_log_raw") {
+  std::cout << "\n========== 测试17:无参数消息直通 ==========\n";
+  auto sink = std::make_shared<collect_sink>();
+  logger my_logger("RawLogger", sink);
+  my_logger.set_level(level::info);
+
+  // 只有 log_raw 原样输出,大括号不做解析
+  my_logger.log_raw(level::info, "raw {} message");
+  my_logger.log_raw(level::info, "raw {{}} message");
+  std::string owned = "from std::string";
+  my_logger.log_raw(level::warn, owned);
+  std::string_view part = std::string_view("prefix|tail").substr(0, 6);
+  my_logger.log_raw(level::error, part);
+  my_logger.log_raw(level::debug, "filtered");
+  // 无参数的 info() 等仍按格式字符串处理,"{{" 转义为 "{"
+  my_logger.info("constant {{}} message");
+  my_logger.info("formatted {}", 1);
+  REQUIRE_EQ(sink->payloads.size(), 6);
+  CHECK_EQ(sink->payloads[0], "raw {} message");
+  CHECK_EQ(sink->payloads[1], "raw {{}} message");
+  CHECK_EQ(sink->payloads[2], "from std::string");
+  CHECK_EQ(sink->payloads[3], "prefix");
+  CHECK_EQ(sink->payloads[4], "constant {} message");
+  CHECK_EQ(sink->payloads[5], "formatted 1");
+
+  // 直通的消息同样进入 backtrace
+  my_logger.enable_backtrace(4);
+  my_logger.log_raw(level::debug, "raw context");
+  my_logger.log_raw(level::error, "raw trigger");
+  REQUIRE_EQ(sink->payloads.size(), 10);
+  CHECK_EQ(sink->payloads[7], "raw context");
+  CHECK_EQ(sink->payloads[9], "raw trigger");
+
+  // 全局函数
+  set_default_logger(std::make_shared<logger>("RawDefault", sink));
+  mispdlog::log_raw(level::info, "default {{raw}}");
+  mispdlog::info("default {{x}}");
+  CHECK_EQ(sink->payloads[10], "default {{raw}}");
+  CHECK_EQ(sink->payloads[11], "default {x}");
+
+  // 短常量消息: 直通与格式化路径的开销对比
+  auto counter = std::make_shared<count_sink>();
+  logger bench_logger("RawBench", counter);
+  ankerl::nanobench::Bench bench;
+  bench.title("constant message").minEpochIterations(200000);
+  bench.run("info() via fmt::format_to",
+            [&]() { bench_logger.info("connection established"); });
+  bench.run("log_raw()", [&]() {
+    bench_logger.log_raw(level::info, "connection established");
+  });
+  CHECK_GT(counter->count, 0);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_argument_forwarding") {
+  std::cout << "\n========== 测试18:参数零拷贝转发 ==========\n";
+  auto sink = std::make_shared<collect_sink>();
+  auto my_logger = std::make_shared<logger>("ForwardLogger", sink);
+  set_default_logger(my_logger);
+
+  copy_counter counter(7);
+  const copy_counter const_counter(8);
+  copy_counter::copies = 0;
+  copy_counter::moves = 0;
+
+  // 左值、const 左值、右值经过各层接口都不产生拷贝或移动
+  my_logger->info("{}", counter);
+  my_logger->warn("{} {}", const_counter, copy_counter(9));
+  my_logger->log(level::error, "{}", counter);
+  mispdlog::info("{}", counter);
+  mispdlog::critical("{} {}", const_counter, copy_counter(10));
+  MISPDLOG_LOGGER_CALL(my_logger, level::info, "{}", counter);
+  CHECK_EQ(copy_counter::copies, 0);
+  CHECK_EQ(copy_counter::moves, 0);
+
+  // 只能移动的类型可以直接以右值传入
+  my_logger->info("{}", move_only(11));
+  mispdlog::error("{}", move_only(12));
+
+  REQUIRE_EQ(sink->payloads.size(), 8);
+  CHECK_EQ(sink->payloads[0], "7");
+  CHECK_EQ(sink->payloads[1], "8 9");
+  CHECK_EQ(sink->payloads[4], "8 10");
+  CHECK_EQ(sink->payloads[6], "11");
+  CHECK_EQ(sink->payloads[7], "12");
+}
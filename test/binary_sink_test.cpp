@@ -0,0 +1,181 @@
+#define ANKERL_NANOBENCH_IMPLEMENT
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "mispdlog/details/binary_format.h"
+#include "mispdlog/mispdlog.h"
+#include "mispdlog/sinks/binary_file_sink.h"
+#include "mispdlog/sinks/file_sink.h"
+
+#include <doctest.h>
+#include <fstream>
+#include <memory>
+#include <nanobench.h>
+#include <string>
+#include <vector>
+
+using namespace mispdlog;
+
+namespace {
+// 带源码位置、线程 id 和纳秒的完整格式,用来逐字节比较解码结果
+constexpr char full_pattern[] =
+    "[%Y-%m-%d %H:%M:%S.%F][%l][%n][%t][%@][%!] %v";
+
+std::string read_file(const std::string &filename) {
+  std::ifstream f(filename, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(f)),
+                     std::istreambuf_iterator<char>());
+}
+
+std::string decode(const std::string &filename, const std::string &pattern) {
+  details::binary_reader reader(filename);
+  pattern_formatter formatter(pattern);
+  details::log_message msg;
+  memory_buf_t buf;
+  while (reader.next(msg)) {
+    formatter.format(msg, buf);
+  }
+  return std::string(buf.data(), buf.size());
+}
+
+void write_messages(logger &log) {
+  std::string owned = "owned string";
+  const char *text = "c string";
+  MISPDLOG_INFO(&log, "int {} unsigned {} char {} bool {}", -12345, 42u, 'x',
+                false);
+  MISPDLOG_WARN(&log, "float {} double {:.4f} long {}", 1.25f, 2.71828,
+                -9000000000LL);
+  MISPDLOG_ERROR(&log, "text {} / {} / {}", text, owned, string_view_t(owned));
+  log.info("no location {:>8}|{:<4}|", 7, "ab");
+  log.critical("plain message");
+  for (int i = 0; i < 3; i++) {
+    MISPDLOG_INFO(&log, "loop {} of {}", i, 3);
+  }
+}
+} // namespace
+
+// NOLINTNEXTLINE
+TEST_CASE("test_binary_roundtrip") {
+  std::cout << "\n========== 测试1:二进制日志解码与文本一致 ==========\n";
+  for (bool deferred : {false, true}) {
+    {
+      auto text_sink =
+          std::make_shared<sinks::file_sink_mt>("logs/roundtrip.log", true);
+      text_sink->set_formatter(
+          std::make_unique<pattern_formatter>(full_pattern));
+      auto binary_sink = std::make_shared<sinks::binary_file_sink_mt>(
+          "logs/roundtrip.bin", true);
+      logger log("roundtrip", {text_sink, binary_sink});
+      log.set_deferred_format(deferred);
+      write_messages(log);
+      log.flush();
+    }
+    std::string text = read_file("logs/roundtrip.log");
+    CHECK_FALSE(text.empty());
+    CHECK_EQ(decode("logs/roundtrip.bin", full_pattern), text);
+  }
+
+  // async_logger: 后台线程渲染,调用方只拷贝参数
+  {
+    auto text_sink =
+        std::make_shared<sinks::file_sink_mt>("logs/roundtrip_async.log", true);
+    text_sink->set_formatter(std::make_unique<pattern_formatter>(full_pattern));
+    auto binary_sink = std::make_shared<sinks::binary_file_sink_mt>(
+        "logs/roundtrip_async.bin", true);
+    async_logger log("roundtrip_async",
+                     std::vector<sinks::sink_ptr>{text_sink, binary_sink});
+    log.set_deferred_format(true);
+    write_messages(log);
+    log.flush();
+  }
+  CHECK_EQ(decode("logs/roundtrip_async.bin", full_pattern),
+           read_file("logs/roundtrip_async.log"));
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_binary_append_sessions") {
+  std::cout << "\n========== 测试2:追加写入多个会话 ==========\n";
+  for (int session = 0; session < 3; session++) {
+    auto sink = std::make_shared<sinks::binary_file_sink_st>(
+        "logs/sessions.bin", session == 0);
+    logger log(session % 2 == 0 ? "even" : "odd", sink);
+    log.set_deferred_format(true);
+    log.info("session {}", session);
+    log.info("session {} again", session);
+  }
+  CHECK_EQ(decode("logs/sessions.bin", "%n %v"),
+           "even session 0\neven session 0 again\n"
+           "odd session 1\nodd session 1 again\n"
+           "even session 2\neven session 2 again\n");
+
+  // 截断的文件报错而不是输出错误内容
+  std::string bytes = read_file("logs/sessions.bin");
+  {
+    std::ofstream f("logs/truncated.bin", std::ios::binary | std::ios::trunc);
+    f.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 3));
+  }
+  CHECK_THROWS_AS(decode("logs/truncated.bin", "%v"), std::runtime_error);
+  CHECK_THROWS_AS(details::binary_reader("logs/roundtrip.log"),
+                  std::runtime_error);
+  // 同一调用点、同一地址上的不同运行时格式串按内容区分
+  {
+    auto sink = std::make_shared<sinks::binary_file_sink_st>(
+        "logs/runtime_format.bin", true);
+    logger log("runtime", sink);
+    log.set_deferred_format(true);
+    for (const char *text : {"first {}", "second {}", "first {}"}) {
+      std::string format = text;
+      log.info(fmt::runtime(format), 1);
+    }
+  }
+  CHECK_EQ(decode("logs/runtime_format.bin", "%v"),
+           "first 1\nsecond 1\nfirst 1\n");
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_binary_size_and_performance") {
+  std::cout << "\n========== 测试3:写入字节数与生产者开销 ==========\n";
+  constexpr int count = 20000;
+  {
+    auto text_sink =
+        std::make_shared<sinks::file_sink_st>("logs/size_text.log", true);
+    text_sink->set_formatter(std::make_unique<pattern_formatter>(full_pattern));
+    auto binary_sink =
+        std::make_shared<sinks::binary_file_sink_st>("logs/size.bin", true);
+    logger text_log("size", text_sink);
+    logger binary_log("size", binary_sink);
+    binary_log.set_deferred_format(true);
+    for (int i = 0; i < count; i++) {
+      MISPDLOG_INFO(&text_log, "request {} took {:.2f} ms from {}", i,
+                    i * 0.01, "10.0.0.1");
+      MISPDLOG_INFO(&binary_log, "request {} took {:.2f} ms from {}", i,
+                    i * 0.01, "10.0.0.1");
+    }
+  }
+  auto text_size = read_file("logs/size_text.log").size();
+  auto binary_size = read_file("logs/size.bin").size();
+  std::cout << "文本: " << text_size << " 字节, 二进制: " << binary_size
+            << " 字节, 压缩比 " << double(text_size) / double(binary_size)
+            << "\n";
+  CHECK_LT(binary_size * 3, text_size);
+
+  CHECK_NOTHROW(
+      auto text_sink =
+          std::make_shared<sinks::file_sink_st>("logs/bench_text.log", true);
+      text_sink->set_formatter(
+          std::make_unique<pattern_formatter>(full_pattern));
+      auto binary_sink =
+          std::make_shared<sinks::binary_file_sink_st>("logs/bench.bin", true);
+      logger text_log("bench", text_sink);
+      logger binary_log("bench", binary_sink);
+      binary_log.set_deferred_format(true); ankerl::nanobench::Bench bench;
+      bench.minEpochIterations(20000);
+      bench.run("text file sink",
+                [&]() {
+                  MISPDLOG_INFO(&text_log, "request {} took {:.2f} ms from {}",
+                                42, 1.5, "10.0.0.1");
+                });
+      bench.run("binary file sink, deferred", [&]() {
+        MISPDLOG_INFO(&binary_log, "request {} took {:.2f} ms from {}", 42, 1.5,
+                      "10.0.0.1");
+      }););
+}
@@ -0,0 +1,109 @@
+#define ANKERL_NANOBENCH_IMPLEMENT
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "mispdlog/mispdlog.h"
+#include "mispdlog/sinks/base_sink.h"
+#include "mispdlog/sinks/dup_filter_sink.h"
+
+#include <chrono>
+#include <doctest.h>
+#include <memory>
+#include <mutex>
+#include <nanobench.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mispdlog;
+
+namespace {
+// 记录收到的每条消息
+class capture_sink : public sinks::base_sink<std::mutex> {
+public:
+  std::vector<std::string> payloads;
+  std::vector<level> levels;
+
+protected:
+  void sink_it_(const details::log_message &msg) override {
+    payloads.emplace_back(msg.payload);
+    levels.push_back(msg.level);
+  }
+  void flush_() override {}
+};
+} // namespace
+
+// NOLINTNEXTLINE
+TEST_CASE("test_dup_filter_basic") {
+  std::cout << "\n========== 测试1:丢弃连续重复消息 ==========\n";
+  auto capture = std::make_shared<capture_sink>();
+  auto filter = std::make_shared<sinks::dup_filter_sink_mt>(
+      std::chrono::seconds(5), std::vector<sinks::sink_ptr>{capture});
+  logger log("dup", filter);
+
+  for (int i = 0; i < 1000; i++) {
+    log.error("connection refused");
+  }
+  log.error("connection refused, giving up");
+  REQUIRE_EQ(capture->payloads.size(), 3);
+  CHECK_EQ(capture->payloads[0], "connection refused");
+  CHECK_EQ(capture->payloads[1], "Skipped 999 duplicate messages..");
+  CHECK_EQ(capture->levels[1], level::error);
+  CHECK_EQ(capture->payloads[2], "connection refused, giving up");
+
+  // 相同内容但级别不同不算重复
+  log.warn("connection refused, giving up");
+  CHECK_EQ(capture->payloads.size(), 4);
+
+  // flush 时报告尚未输出的丢弃数
+  log.warn("connection refused, giving up");
+  log.warn("connection refused, giving up");
+  log.flush();
+  REQUIRE_EQ(capture->payloads.size(), 5);
+  CHECK_EQ(capture->payloads[4], "Skipped 2 duplicate messages..");
+  log.flush();
+  CHECK_EQ(capture->payloads.size(), 5);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_dup_filter_window") {
+  std::cout << "\n========== 测试2:时间窗口过后重新输出 ==========\n";
+  auto capture = std::make_shared<capture_sink>();
+  auto filter = std::make_shared<sinks::dup_filter_sink_st>(
+      std::chrono::milliseconds(20));
+  filter->add_sink(capture);
+  logger log("dup_window", filter);
+
+  log.info("tick");
+  log.info("tick");
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  log.info("tick");
+  REQUIRE_EQ(capture->payloads.size(), 3);
+  CHECK_EQ(capture->payloads[1], "Skipped 1 duplicate messages..");
+  CHECK_EQ(capture->payloads[2], "tick");
+
+  // 被移除的 sink 不再收到消息
+  filter->remove_sink(capture);
+  log.info("after remove");
+  CHECK_EQ(capture->payloads.size(), 3);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_dup_filter_flood") {
+  std::cout << "\n========== 测试3:错误风暴下的写入开销 ==========\n";
+  CHECK_NOTHROW(
+      auto plain = std::make_shared<sinks::rotating_file_sink_mt>(
+          "logs/flood_plain.log", 1024 * 1024, 3);
+      auto filtered = std::make_shared<sinks::rotating_file_sink_mt>(
+          "logs/flood_filtered.log", 1024 * 1024, 3);
+      auto filter = std::make_shared<sinks::dup_filter_sink_mt>(
+          std::chrono::seconds(10), std::vector<sinks::sink_ptr>{filtered});
+      logger plain_log("flood_plain", plain);
+      logger filtered_log("flood_filtered", filter);
+
+      ankerl::nanobench::Bench bench; bench.minEpochIterations(50000);
+      bench.run("rotating_file_sink, error flood",
+                [&]() { plain_log.error("disk {} is full", "/dev/sda1"); });
+      bench.run("dup_filter_sink + rotating_file_sink, error flood", [&]() {
+        filtered_log.error("disk {} is full", "/dev/sda1");
+      }););
+}
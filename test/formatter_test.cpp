@@ -4,6 +4,7 @@
 #include "mispdlog/level.h"
 #include "mispdlog/pattern_formatter.h"
 #include "mispdlog/sinks/console_sink.h"
+#include "mispdlog/static_pattern_formatter.h"
 
 #include <doctest.h>
 #include <fmt/format.h>
@@ -22,7 +23,7 @@ TEST_CASE("test_pattern_compilation") {
   CHECK_NOTHROW(for (const auto &pattern
                      : patterns) {
     pattern_formatter formatter(pattern);
-    fmt::memory_buffer buf;
+    memory_buf_t buf;
 
     details::log_message msg("TestLogger", level::info, "Hello, World!");
     formatter.format(msg, buf);
@@ -42,7 +43,7 @@ TEST_CASE("test_all_flags") {
           "Level:%l(%L) Name:%n Thread:%t Msg:%v");
 
       details::log_message msg("MyLogger", level::warn, "Test message");
-      fmt::memory_buffer buf; formatter.format(msg, buf);
+      memory_buf_t buf; formatter.format(msg, buf);
 
       std::cout << std::string(buf.data(), buf.size()););
 }
@@ -82,7 +83,7 @@ TEST_CASE("test_time_caching") {
       const int iterations = 10000;
       for (int i = 0; i < iterations; ++i) {
         details::log_message msg("PerfTest", level::info, "Test message");
-        fmt::memory_buffer buf;
+        memory_buf_t buf;
         formatter.format(msg, buf);
       }
 
@@ -120,7 +121,7 @@ TEST_CASE("test_custom_patterns") {
         pattern_formatter formatter(test.pattern);
         details::log_message msg("CustomLogger", level::info,
                                  "Sample log message");
-        fmt::memory_buffer buf;
+        memory_buf_t buf;
         formatter.format(msg, buf);
 
         std::cout << "描述: " << test.description << "\n";
@@ -134,7 +135,7 @@ TEST_CASE("test_escape_percent") {
   CHECK_NOTHROW(
       pattern_formatter formatter("Progress: 50%% - %v");
       details::log_message msg("TestLogger", level::info, "Task completed");
-      fmt::memory_buffer buf; formatter.format(msg, buf);
+      memory_buf_t buf; formatter.format(msg, buf);
 
       std::cout << "Pattern: Progress: 50%% - %v\n";
       std::cout << "Output:  " << std::string(buf.data(), buf.size()););
@@ -210,9 +211,197 @@ TEST_CASE("test_unknown_flags") {
   CHECK_NOTHROW(
       pattern_formatter formatter("[%Y-%m-%d] [%Z] %v"); // %Z 是未知占位符
       details::log_message msg("TestLogger", level::info, "Test unknown flags");
-      fmt::memory_buffer buf; formatter.format(msg, buf);
+      memory_buf_t buf; formatter.format(msg, buf);
 
       std::cout << "Pattern: [%Y-%m-%d] [%Z] %v\n";
       std::cout << "Output:  " << std::string(buf.data(), buf.size());
       std::cout << "说明: 未知占位符 %Z 被原样输出\n";);
-}
\ No newline at end of file
+}
+// NOLINTNEXTLINE
+TEST_CASE("test_inline_buffer") {
+  std::cout << "\n========== 测试11:栈上 buffer ==========\n";
+  pattern_formatter formatter;
+  details::log_message msg("TestLogger", level::info, "Typical log line");
+  memory_buf_t buf;
+  formatter.format(msg, buf);
+  // 普通长度的日志不会发生堆分配
+  CHECK_EQ(buf.capacity(), MISPDLOG_INLINE_BUFFER_SIZE);
+
+  // 默认容量不小于 fmt::memory_buffer,400 字节的日志仍在栈上
+  static_assert(MISPDLOG_INLINE_BUFFER_SIZE >= 500);
+  std::string medium_payload(400, 'm');
+  details::log_message medium_msg("TestLogger", level::info, medium_payload);
+  memory_buf_t medium_buf;
+  formatter.format(medium_msg, medium_buf);
+  CHECK_EQ(medium_buf.capacity(), MISPDLOG_INLINE_BUFFER_SIZE);
+
+  std::string long_payload(MISPDLOG_INLINE_BUFFER_SIZE * 2, 'x');
+  details::log_message long_msg("TestLogger", level::info, long_payload);
+  memory_buf_t long_buf;
+  formatter.format(long_msg, long_buf);
+  // 超长日志退化到堆上,内容完整
+  CHECK_GT(long_buf.capacity(), MISPDLOG_INLINE_BUFFER_SIZE);
+  CHECK_GT(long_buf.size(), long_payload.size());
+}
+
+static constexpr char k_full_pattern[] =
+    "Year:%Y Month:%m Day:%d Hour:%H Min:%M Sec:%S "
+    "Level:%l(%L) Name:%n Thread:%t Msg:%v";
+static constexpr char k_escape_pattern[] = "Progress: 50%% - %v [%Z] %";
+static constexpr char k_no_time_pattern[] = "[%n] [%l] %v";
+
+template <const char *Pattern> static void check_same_output() {
+  pattern_formatter dynamic_formatter(Pattern);
+  static_pattern_formatter<Pattern> static_formatter;
+  details::log_message msg("StaticLogger", level::warn, "Test message");
+  memory_buf_t dynamic_buf;
+  memory_buf_t static_buf;
+  dynamic_formatter.format(msg, dynamic_buf);
+  static_formatter.format(msg, static_buf);
+  CHECK_EQ(fmt::to_string(dynamic_buf), fmt::to_string(static_buf));
+  // 相同 pattern 的输出可以在 sink 间共享
+  CHECK_EQ(dynamic_formatter.pattern_id(), static_formatter.pattern_id());
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_static_pattern_formatter") {
+  std::cout << "\n========== 测试12:编译期 Pattern ==========\n";
+  check_same_output<default_pattern>();
+  check_same_output<k_full_pattern>();
+  check_same_output<k_escape_pattern>();
+  check_same_output<k_no_time_pattern>();
+
+  pattern_formatter dynamic_formatter;
+  static_pattern_formatter<default_pattern> static_formatter;
+  details::log_message msg("PerfTest", level::info, "Test message");
+  ankerl::nanobench::Bench bench;
+  bench.minEpochIterations(10000);
+  bench.run("pattern_formatter", [&]() {
+    memory_buf_t buf;
+    dynamic_formatter.format(msg, buf);
+    ankerl::nanobench::doNotOptimizeAway(buf.size());
+  });
+  bench.run("static_pattern_formatter", [&]() {
+    memory_buf_t buf;
+    static_formatter.format(msg, buf);
+    ankerl::nanobench::doNotOptimizeAway(buf.size());
+  });
+}
+
+static constexpr char k_mixed_pattern[] = "%H:%M [%l] %S %v";
+
+template <typename Formatter, typename Fresh>
+static void check_time_cache(Formatter &reused, Fresh make_fresh) {
+  auto now = log_clock::now();
+  for (int i = 0; i < 3; i++) {
+    // 跨秒后缓存必须刷新
+    details::log_message msg("TimeCache", level::info,
+                             now + std::chrono::seconds(i * 61),
+                             details::source_location(), "cached");
+    memory_buf_t reused_buf;
+    memory_buf_t fresh_buf;
+    reused.format(msg, reused_buf);
+    auto fresh = make_fresh();
+    fresh->format(msg, fresh_buf);
+    CHECK_EQ(fmt::to_string(reused_buf), fmt::to_string(fresh_buf));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_time_segment_cache") {
+  std::cout << "\n========== 测试13:时间段缓存 ==========\n";
+  pattern_formatter dynamic_formatter;
+  check_time_cache(dynamic_formatter, []() {
+    return std::make_unique<pattern_formatter>();
+  });
+  pattern_formatter mixed_formatter(k_mixed_pattern);
+  check_time_cache(mixed_formatter, []() {
+    return std::make_unique<pattern_formatter>(k_mixed_pattern);
+  });
+  static_pattern_formatter<default_pattern> static_formatter;
+  check_time_cache(static_formatter, []() {
+    return std::make_unique<pattern_formatter>(default_pattern);
+  });
+  static_pattern_formatter<k_mixed_pattern> static_mixed;
+  check_time_cache(static_mixed, []() {
+    return std::make_unique<pattern_formatter>(k_mixed_pattern);
+  });
+}
+
+static constexpr char k_subsecond_pattern[] = "%S.%e|%f|%F %v";
+
+// NOLINTNEXTLINE
+TEST_CASE("test_subsecond_flags") {
+  std::cout << "\n========== 测试14:亚秒级占位符 ==========\n";
+  auto since_epoch =
+      std::chrono::seconds(1700000007) + std::chrono::nanoseconds(12345678);
+  auto tp = log_clock::time_point(
+      std::chrono::duration_cast<log_clock::duration>(since_epoch));
+  details::log_message msg("SubSecond", level::info, tp,
+                           details::source_location(), "tick");
+
+  pattern_formatter dynamic_formatter(k_subsecond_pattern);
+  memory_buf_t buf;
+  dynamic_formatter.format(msg, buf);
+  std::string expected_tail = ".012|012345|012345678 tick\n";
+  std::string output = fmt::to_string(buf);
+  std::cout << "Output:  " << output;
+  REQUIRE_GT(output.size(), expected_tail.size());
+  CHECK_EQ(output.substr(output.size() - expected_tail.size()), expected_tail);
+
+  static_pattern_formatter<k_subsecond_pattern> static_formatter;
+  memory_buf_t static_buf;
+  static_formatter.format(msg, static_buf);
+  CHECK_EQ(fmt::to_string(static_buf), output);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_fast_digits") {
+  std::cout << "\n========== 测试15:快速数字输出 ==========\n";
+  memory_buf_t buf;
+  details::pad2(7, buf);
+  details::pad2(42, buf);
+  details::pad4(2025, buf);
+  details::pad_uint<3>(5, buf);
+  details::pad_uint<9>(123456789, buf);
+  buf.push_back('|');
+  details::append_uint(0, buf);
+  buf.push_back('|');
+  details::append_uint(1234567890123ULL, buf);
+  CHECK_EQ(fmt::to_string(buf), "07422025005123456789|0|1234567890123");
+}
+
+static constexpr char k_source_pattern[] = "[%s] [%#] [%!] [%@] %v";
+
+// NOLINTNEXTLINE
+TEST_CASE("test_source_location_flags") {
+  std::cout << "\n========== 测试16:源码位置占位符 ==========\n";
+  details::source_location loc("src/net/socket.cpp", 128, "connect");
+  details::log_message msg("SourceLogger", level::info, loc, "connected");
+
+  pattern_formatter dynamic_formatter(k_source_pattern);
+  memory_buf_t buf;
+  dynamic_formatter.format(msg, buf);
+  // 第二次命中 basename 缓存,输出不变
+  memory_buf_t again;
+  dynamic_formatter.format(msg, again);
+  std::cout << "Output:  " << fmt::to_string(buf);
+  CHECK_EQ(fmt::to_string(buf),
+           "[socket.cpp] [128] [connect] [socket.cpp:128] connected\n");
+  CHECK_EQ(fmt::to_string(again), fmt::to_string(buf));
+
+  static_pattern_formatter<k_source_pattern> static_formatter;
+  memory_buf_t static_buf;
+  static_formatter.format(msg, static_buf);
+  CHECK_EQ(fmt::to_string(static_buf), fmt::to_string(buf));
+
+  // 没有源码位置时输出为空
+  details::log_message plain("SourceLogger", level::info, "plain");
+  memory_buf_t plain_buf;
+  dynamic_formatter.format(plain, plain_buf);
+  CHECK_EQ(fmt::to_string(plain_buf), "[] [] [] [] plain\n");
+
+  CHECK_EQ(details::path_basename("a/b/c.h"), "c.h");
+  CHECK_EQ(details::path_basename("c.h"), "c.h");
+  static_assert(details::path_basename("dir/file.cpp") == "file.cpp");
+}
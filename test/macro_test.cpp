@@ -0,0 +1,212 @@
+#define ANKERL_NANOBENCH_IMPLEMENT
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+// 编译期剔除 trace/debug
+#define MISPDLOG_ACTIVE_LEVEL MISPDLOG_LEVEL_INFO
+
+#include "mispdlog/mispdlog.h"
+#include "mispdlog/sinks/base_sink.h"
+
+#include <chrono>
+#include <cstring>
+#include <doctest.h>
+#include <memory>
+#include <mutex>
+#include <nanobench.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mispdlog;
+
+namespace {
+// 记录每条消息的源码位置和内容
+class capture_sink : public sinks::base_sink<std::mutex> {
+public:
+  struct record {
+    std::string filename;
+    int line;
+    std::string function_name;
+    std::string payload;
+  };
+  std::vector<record> records;
+
+protected:
+  void sink_it_(const details::log_message &msg) override {
+    records.push_back({msg.loc.filename ? msg.loc.filename : "", msg.loc.line,
+                       msg.loc.function_name ? msg.loc.function_name : "",
+                       std::string(msg.payload)});
+  }
+  void flush_() override {}
+};
+
+int evaluated = 0;
+int side_effect() { return ++evaluated; }
+} // namespace
+
+// NOLINTNEXTLINE
+TEST_CASE("test_macro_source_location") {
+  std::cout << "\n========== 测试1:宏捕获源码位置 ==========\n";
+  auto sink = std::make_shared<capture_sink>();
+  auto my_logger = std::make_shared<logger>("MacroLogger", sink);
+
+  int line = __LINE__ + 1;
+  MISPDLOG_INFO(my_logger, "hello {}", 42);
+  MISPDLOG_CRITICAL(my_logger, "no args");
+
+  REQUIRE_EQ(sink->records.size(), 2);
+  const auto &rec = sink->records[0];
+  CHECK_EQ(rec.payload, "hello 42");
+  CHECK_EQ(rec.line, line);
+  CHECK_NE(rec.filename.find("macro_test.cpp"), std::string::npos);
+  CHECK_FALSE(rec.function_name.empty());
+  CHECK_EQ(sink->records[1].line, line + 1);
+
+  // 普通接口不带源码位置
+  my_logger->warn("plain");
+  REQUIRE_EQ(sink->records.size(), 3);
+  CHECK_EQ(sink->records[2].line, 0);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_macro_compile_time_strip") {
+  std::cout << "\n========== 测试2:编译期剔除低级别 ==========\n";
+  auto sink = std::make_shared<capture_sink>();
+  auto my_logger = std::make_shared<logger>("StripLogger", sink);
+  my_logger->set_level(level::trace);
+  evaluated = 0;
+
+  // 低于 MISPDLOG_ACTIVE_LEVEL,参数不会被求值
+  MISPDLOG_TRACE(my_logger, "trace {}", side_effect());
+  MISPDLOG_DEBUG(my_logger, "debug {}", side_effect());
+  CHECK_EQ(evaluated, 0);
+  CHECK(sink->records.empty());
+
+  MISPDLOG_INFO(my_logger, "info {}", side_effect());
+  MISPDLOG_WARN(my_logger, "warn {}", side_effect());
+  MISPDLOG_ERROR(my_logger, "error {}", side_effect());
+  CHECK_EQ(evaluated, 3);
+  CHECK_EQ(sink->records.size(), 3);
+
+  // 运行期级别仍然生效
+  my_logger->set_level(level::error);
+  MISPDLOG_INFO(my_logger, "filtered");
+  CHECK_EQ(sink->records.size(), 3);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_macro_benchmark") {
+  std::cout << "\n========== 测试3:剔除宏与运行期过滤对比 ==========\n";
+  auto sink = std::make_shared<capture_sink>();
+  auto my_logger = std::make_shared<logger>("BenchLogger", sink);
+  my_logger->set_level(level::info);
+  std::string text = "payload";
+
+  ankerl::nanobench::Bench()
+      .title("disabled debug")
+      .minEpochIterations(100000)
+      .run("runtime filtered debug()",
+           [&]() { my_logger->debug("value {} {}", text, 3.14); })
+      .run("compile time stripped MISPDLOG_DEBUG",
+           [&]() { MISPDLOG_DEBUG(my_logger, "value {} {}", text, 3.14); });
+  CHECK(sink->records.empty());
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_macro_throttle") {
+  std::cout << "\n========== 测试4:调用点限流与采样 ==========\n";
+  auto sink = std::make_shared<capture_sink>();
+  auto my_logger = std::make_shared<logger>("ThrottleLogger", sink);
+  evaluated = 0;
+
+  for (int i = 0; i < 1000; i++) {
+    MISPDLOG_WARN_EVERY_N(my_logger, 100, "probe {} failed {}", i,
+                          side_effect());
+  }
+  // 被丢弃的调用不求值参数,数量附在下一条输出上
+  CHECK_EQ(evaluated, 10);
+  REQUIRE_EQ(sink->records.size(), 10);
+  CHECK_EQ(sink->records[0].payload, "probe 0 failed 1");
+  CHECK_EQ(sink->records[1].payload, "probe 100 failed 2 [99 suppressed]");
+  CHECK_NE(sink->records[1].line, 0);
+
+  // logger 表达式只求值一次
+  int lookups = 0;
+  auto lookup = [&]() {
+    lookups++;
+    return my_logger;
+  };
+  MISPDLOG_WARN_EVERY_N(lookup(), 1, "lookup {}", 1);
+  MISPDLOG_WARN_EVERY_MS(lookup(), 0, "lookup {}", 2);
+  CHECK_EQ(lookups, 2);
+  REQUIRE_EQ(sink->records.size(), 12);
+  CHECK_EQ(sink->records[11].payload, "lookup 2");
+
+  // 编译期剔除的级别同样不求值
+  MISPDLOG_DEBUG_EVERY_N(my_logger, 1, "debug {}", side_effect());
+  MISPDLOG_DEBUG_SAMPLED(my_logger, 1.0, "debug {}", side_effect());
+  CHECK_EQ(evaluated, 10);
+
+  sink->records.clear();
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 50; i++) {
+      MISPDLOG_ERROR_EVERY_MS(my_logger, 20, "flood {}", round);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  }
+  REQUIRE_EQ(sink->records.size(), 3);
+  CHECK_EQ(sink->records[0].payload, "flood 0");
+  CHECK_EQ(sink->records[1].payload, "flood 1 [49 suppressed]");
+  CHECK_EQ(sink->records[2].payload, "flood 2 [49 suppressed]");
+
+  sink->records.clear();
+  constexpr int calls = 100000;
+  for (int i = 0; i < calls; i++) {
+    MISPDLOG_INFO_SAMPLED(my_logger, 0.05, "sampled {}", i);
+  }
+  for (int i = 0; i < 100; i++) {
+    MISPDLOG_INFO_SAMPLED(my_logger, 0.0, "never {}", i);
+  }
+  size_t sampled = sink->records.size();
+  std::cout << "采样输出: " << sampled << " / " << calls << "\n";
+  CHECK_GT(sampled, 4000);
+  CHECK_LT(sampled, 6000);
+
+  // 运行期级别过滤时不计数
+  sink->records.clear();
+  my_logger->set_level(level::error);
+  for (int i = 0; i < 10; i++) {
+    MISPDLOG_WARN_EVERY_N(my_logger, 2, "filtered {}", i);
+  }
+  CHECK(sink->records.empty());
+
+  // 开启 backtrace 后,被级别过滤的限流调用进入环中,与 log() 一致
+  my_logger->enable_backtrace(4);
+  for (int i = 0; i < 6; i++) {
+    MISPDLOG_WARN_EVERY_N(my_logger, 2, "context {}", i);
+  }
+  CHECK(sink->records.empty());
+  MISPDLOG_ERROR(my_logger, "trigger");
+  REQUIRE_EQ(sink->records.size(), 6);
+  CHECK_EQ(sink->records[1].payload, "context 0");
+  CHECK_EQ(sink->records[2].payload, "context 2 [1 suppressed]");
+  CHECK_EQ(sink->records[3].payload, "context 4 [1 suppressed]");
+  CHECK_EQ(sink->records[5].payload, "trigger");
+  my_logger->disable_backtrace();
+
+  my_logger->set_level(level::info);
+  sink->records.clear();
+  std::string text = "payload";
+  ankerl::nanobench::Bench()
+      .title("throttled warn")
+      .minEpochIterations(100000)
+      .run("suppressed MISPDLOG_WARN_EVERY_N",
+           [&]() {
+             MISPDLOG_WARN_EVERY_N(my_logger, 1000000000, "value {} {}", text,
+                                   3.14);
+           })
+      .run("suppressed MISPDLOG_WARN_SAMPLED", [&]() {
+        MISPDLOG_WARN_SAMPLED(my_logger, 0.0, "value {} {}", text, 3.14);
+      });
+  CHECK_EQ(sink->records.size(), 1);
+}
@@ -1,15 +1,23 @@
 #define ANKERL_NANOBENCH_IMPLEMENT
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
+#include "mispdlog/details/worker_pool.h"
 #include "mispdlog/level.h"
 #include "mispdlog/logger.h"
 #include "mispdlog/mispdlog.h"
 #include "mispdlog/sinks/console_sink.h"
 
+#include <atomic>
+#include <chrono>
 #include <doctest.h>
 #include <fmt/format.h>
+#include <fstream>
+#include <mutex>
 #include <nanobench.h>
+#include <set>
+#include <string>
 #include <thread>
+#include <vector>
 
 using namespace mispdlog;
 // NOLINTNEXTLINE
@@ -349,4 +357,495 @@ TEST_CASE("test_flush_all") {
       std::cout << " 执行 flush_all(),所有 logger 已刷新到磁盘\n";
 
       drop_all(););
-}
\ No newline at end of file
+}
+// NOLINTNEXTLINE
+TEST_CASE("test_default_logger_fast_path") {
+  std::cout << "\n========== 测试14:默认 Logger 无锁访问 ==========\n";
+  auto sink1 =
+      std::make_shared<sinks::file_sink_mt>("logs/default1.log", true);
+  auto sink2 =
+      std::make_shared<sinks::file_sink_mt>("logs/default2.log", true);
+  auto logger1 = std::make_shared<logger>("default_fast1", sink1);
+  auto logger2 = std::make_shared<logger>("default_fast2", sink2);
+
+  set_default_logger(logger1);
+  CHECK_EQ(default_logger_raw(), logger1.get());
+  set_default_logger(logger2);
+  // 替换后下一次调用立即看到新的默认 logger
+  CHECK_EQ(default_logger_raw(), logger2.get());
+
+  // 日志线程与替换线程并发
+  std::atomic<bool> running{true};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; t++) {
+    workers.emplace_back([&running]() {
+      while (running) {
+        info("global message");
+      }
+    });
+  }
+  for (int i = 0; i < 200; i++) {
+    set_default_logger(i % 2 ? logger1 : logger2);
+  }
+  running = false;
+  for (auto &w : workers) {
+    w.join();
+  }
+  CHECK_EQ(default_logger_raw(), default_logger().get());
+
+  ankerl::nanobench::Bench bench;
+  bench.title("default logger access").minEpochIterations(100000);
+  bench.run("default_logger()", [&]() {
+    ankerl::nanobench::doNotOptimizeAway(default_logger());
+  });
+  bench.run("default_logger_raw()", [&]() {
+    ankerl::nanobench::doNotOptimizeAway(default_logger_raw());
+  });
+
+  // 多线程下的吞吐,raw 路径不再串行化在 registry 锁上
+  auto contended = [](auto access) {
+    constexpr int k_threads = 8;
+    constexpr int k_calls = 200000;
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_threads; t++) {
+      threads.emplace_back([&access]() {
+        for (int i = 0; i < k_calls; i++) {
+          ankerl::nanobench::doNotOptimizeAway(access());
+        }
+      });
+    }
+    for (auto &th : threads) {
+      th.join();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - begin)
+        .count();
+  };
+  std::cout << "8 线程 default_logger(): "
+            << contended([]() { return default_logger(); }) << " ms\n";
+  std::cout << "8 线程 default_logger_raw(): "
+            << contended([]() { return default_logger_raw(); }) << " ms\n";
+
+  drop_all();
+  CHECK_NE(default_logger_raw(), logger2.get());
+  CHECK_NE(default_logger_raw(), nullptr);
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_snapshot_lookup") {
+  std::cout << "\n========== 测试15:快照查找 ==========\n";
+  auto sink = std::make_shared<sinks::file_sink_mt>("logs/snapshot.log", true);
+  auto db = std::make_shared<logger>("db", sink);
+  register_logger(db);
+
+  // string_view / 字面量查找不分配
+  std::string_view name = "db";
+  CHECK_EQ(get_logger(name), db);
+  CHECK_EQ(get_logger_raw("db"), db.get());
+  CHECK_EQ(get_logger_raw("missing"), nullptr);
+
+  // 写者发布新快照后,读者下一次查找可见
+  drop("db");
+  CHECK_EQ(get_logger("db"), nullptr);
+  register_logger(db);
+  CHECK_EQ(get_logger_raw("db"), db.get());
+
+  // 并发读写
+  std::atomic<bool> running{true};
+  std::atomic<int> misses{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      while (running) {
+        if (get_logger_raw("db") == nullptr) {
+          misses++;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 500; i++) {
+    auto temp = std::make_shared<logger>(fmt::format("temp_{}", i), sink);
+    register_logger(temp);
+    drop(temp->name());
+  }
+  running = false;
+  for (auto &r : readers) {
+    r.join();
+  }
+  CHECK_EQ(misses.load(), 0);
+
+  // 64 线程竞争下主线程的查找开销
+  constexpr int k_threads = 63;
+  auto contended = [&](const char *title, auto lookup) {
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_threads; t++) {
+      threads.emplace_back([&]() {
+        while (stop.load(std::memory_order_relaxed) == false) {
+          ankerl::nanobench::doNotOptimizeAway(lookup());
+        }
+      });
+    }
+    ankerl::nanobench::Bench().minEpochIterations(20000).run(
+        title, [&]() { ankerl::nanobench::doNotOptimizeAway(lookup()); });
+    stop = true;
+    for (auto &th : threads) {
+      th.join();
+    }
+  };
+  contended("get_logger, 64 threads", []() { return get_logger("db"); });
+  contended("get_logger_raw, 64 threads",
+            []() { return get_logger_raw("db"); });
+
+  drop_all();
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_hierarchical_levels") {
+  std::cout << "\n========== 测试16:层级级别 ==========\n";
+  auto sink =
+      std::make_shared<sinks::file_sink_mt>("logs/hierarchy.log", true);
+  auto net = std::make_shared<logger>("net", sink);
+  auto http = std::make_shared<logger>("net.http", sink);
+  auto client = std::make_shared<logger>("net.http.client", sink);
+  auto netflix = std::make_shared<logger>("netflix", sink);
+  auto db = std::make_shared<logger>("db", sink);
+  for (const auto &l : {net, http, client, netflix, db}) {
+    register_logger(l);
+  }
+
+  set_level("net.*", level::debug);
+  CHECK_EQ(net->get_level(), level::debug);
+  CHECK_EQ(http->get_level(), level::debug);
+  CHECK_EQ(client->get_level(), level::debug);
+  // 只按 '.' 分段匹配,"netflix" 不属于 "net"
+  CHECK_EQ(netflix->get_level(), level::trace);
+  CHECK_EQ(db->get_level(), level::trace);
+
+  // 更具体的规则优先,与设置顺序无关
+  set_level("net.http.*", level::error);
+  set_level("net.*", level::warn);
+  CHECK_EQ(net->get_level(), level::warn);
+  CHECK_EQ(http->get_level(), level::error);
+  CHECK_EQ(client->get_level(), level::error);
+  set_level("net.http.client", level::info);
+  CHECK_EQ(client->get_level(), level::info);
+  CHECK_EQ(http->get_level(), level::error);
+
+  // 之后注册的 logger 继承规则
+  auto server = std::make_shared<logger>("net.http.server", sink);
+  register_logger(server);
+  CHECK_EQ(server->get_level(), level::error);
+  CHECK_FALSE(server->should_log(level::warn));
+
+  set_level("*", level::critical);
+  CHECK_EQ(db->get_level(), level::critical);
+  CHECK_EQ(net->get_level(), level::warn);
+
+  CHECK_THROWS_AS(set_level("net*", level::info), std::invalid_argument);
+  CHECK_THROWS_AS(set_level("*.http", level::info), std::invalid_argument);
+  CHECK_THROWS_AS(set_level(".*", level::info), std::invalid_argument);
+
+  // "*" 也覆盖内置默认 logger,无论它在规则之前还是之后创建
+  CHECK_EQ(default_logger()->get_level(), level::critical);
+  drop_all();
+  set_level("*", level::error);
+  CHECK_EQ(default_logger()->get_level(), level::error);
+
+  // set_all_level 覆盖规则,之后注册的 logger 不再继承
+  set_all_level(level::debug);
+  CHECK_EQ(default_logger()->get_level(), level::debug);
+  auto later = std::make_shared<logger>("net.later", sink);
+  register_logger(later);
+  CHECK_EQ(later->get_level(), level::trace);
+
+  // drop_all 清空规则
+  drop_all();
+  auto fresh = std::make_shared<logger>("net.fresh", sink);
+  register_logger(fresh);
+  CHECK_EQ(fresh->get_level(), level::trace);
+  drop_all();
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_flush_every") {
+  std::cout << "\n========== 测试17:后台定时刷新 ==========\n";
+  auto file_log = basic_logger_mt("periodic", "logs/periodic.log", true);
+  file_log->info("buffered line");
+
+  flush_every(std::chrono::milliseconds(20));
+  // 不调用 flush,等待后台线程把内容写到磁盘
+  std::string content;
+  for (int i = 0; i < 100 && content.empty(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::ifstream in("logs/periodic.log");
+    std::getline(in, content);
+  }
+  CHECK_NE(content.find("buffered line"), std::string::npos);
+
+  // 替换刷新间隔,日志线程与后台刷新并发
+  flush_every(std::chrono::milliseconds(1));
+  for (int i = 0; i < 1000; i++) {
+    file_log->info("line {}", i);
+  }
+  // drop_all 停止后台线程
+  auto begin = std::chrono::steady_clock::now();
+  drop_all();
+  flush_every(std::chrono::hours(1));
+  drop_all();
+  CHECK_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+}
+
+// flush 时抛出非 std::exception 的 sink
+class throw_sink : public sinks::base_sink<std::mutex> {
+protected:
+  void sink_it_(const details::log_message &) override {}
+  void flush_() override { throw 42; }
+};
+
+// NOLINTNEXTLINE
+TEST_CASE("test_flush_all_report") {
+  std::cout << "\n========== 测试18:并行刷新报告 ==========\n";
+  drop_all();
+  // 两个 logger 共享一个 sink,只刷新一次
+  auto shared_sink =
+      std::make_shared<sinks::file_sink_mt>("logs/flush_shared.log", true);
+  auto own_sink =
+      std::make_shared<sinks::file_sink_mt>("logs/flush_own.log", true);
+  register_logger(std::make_shared<logger>("flush_a", shared_sink));
+  register_logger(std::make_shared<logger>(
+      "flush_b", std::vector<sinks::sink_ptr>{shared_sink, own_sink}));
+  auto async_log = async_basic_logger_mt("flush_async", "logs/flush_async.log",
+                                         true);
+  async_log->info("queued line");
+
+  auto results = flush_all_loggers();
+  size_t shared_count = 0;
+  size_t own_count = 0;
+  size_t async_count = 0;
+  for (const auto &result : results) {
+    std::cout << "  " << result.logger_name << ": " << result.latency.count()
+              << " us\n";
+    CHECK(result.error.empty());
+    shared_count += result.sink == shared_sink;
+    own_count += result.sink == own_sink;
+    async_count += result.logger_name == "flush_async";
+  }
+  CHECK_EQ(shared_count, 1);
+  CHECK_EQ(own_count, 1);
+  CHECK_EQ(async_count, 1);
+
+  // 异步 logger 经由队列刷新,返回时内容已落盘
+  std::ifstream in("logs/flush_async.log");
+  std::string line;
+  std::getline(in, line);
+  CHECK_NE(line.find("queued line"), std::string::npos);
+  drop_all();
+
+  // sink 抛出非 std::exception 时记录为未知异常,不会终止进程
+  register_logger(
+      std::make_shared<logger>("flush_throw", std::make_shared<throw_sink>()));
+  register_logger(std::make_shared<logger>("flush_ok", own_sink));
+  results = flush_all_loggers();
+  REQUIRE_EQ(results.size(), 2);
+  for (const auto &result : results) {
+    CHECK_EQ(result.error, result.logger_name == "flush_throw"
+                               ? "unknown exception"
+                               : "");
+  }
+  drop_all();
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_glob_bulk_operations") {
+  std::cout << "\n========== 测试19:10 万 logger 批量操作 ==========\n";
+  drop_all();
+  constexpr int k_tenants = 25000;
+  auto sink = std::make_shared<sinks::file_sink_mt>("logs/tenants.log", true);
+  auto begin = std::chrono::steady_clock::now();
+  for (int t = 0; t < k_tenants; t++) {
+    for (const char *component : {"db", "http", "cache", "auth"}) {
+      register_logger(std::make_shared<logger>(
+          fmt::format("tenant.{}.{}", t, component), sink));
+    }
+  }
+  std::cout << "注册 " << k_tenants * 4 << " 个 logger: "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - begin)
+                   .count()
+            << " ms\n";
+
+  set_level_matching("tenant.4217.*", level::error);
+  CHECK_EQ(get_logger("tenant.4217.db")->get_level(), level::error);
+  CHECK_EQ(get_logger("tenant.4217.auth")->get_level(), level::error);
+  // 前缀按字符匹配,"tenant.42170.db" 不在 "tenant.4217.*" 中
+  CHECK_EQ(get_logger("tenant.42.db")->get_level(), level::trace);
+  CHECK_EQ(get_logger("tenant.4218.db")->get_level(), level::trace);
+
+  set_level_matching("tenant.1?.http", level::warn);
+  CHECK_EQ(get_logger("tenant.13.http")->get_level(), level::warn);
+  CHECK_EQ(get_logger("tenant.13.db")->get_level(), level::trace);
+  CHECK_EQ(get_logger("tenant.130.http")->get_level(), level::trace);
+
+  set_level_matching("tenant.7.cache", level::critical);
+  CHECK_EQ(get_logger("tenant.7.cache")->get_level(), level::critical);
+
+  auto results = flush_matching("tenant.99.*");
+  // 4 个 logger 共享同一个 sink,只刷新一次
+  CHECK_EQ(results.size(), 1);
+
+  ankerl::nanobench::Bench bench;
+  bench.title("100k loggers").epochs(3);
+  bench.run("set_level_matching(\"tenant.4217.*\")", [&]() {
+    set_level_matching("tenant.4217.*", level::info);
+  });
+  bench.run("set_level_matching(\"tenant.*.db\")", [&]() {
+    set_level_matching("tenant.*.db", level::info);
+  });
+  bench.run("set_all_level", [&]() { set_all_level(level::info); });
+  bench.run("flush_matching(\"tenant.4217.*\")",
+            [&]() { flush_matching("tenant.4217.*"); });
+  drop_all();
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_lazy_default_logger") {
+  std::cout << "\n========== 测试20:默认 Logger 延迟创建 ==========\n";
+  drop_all();
+  // drop_all 不再立即重建,级别设置保留到创建时
+  set_all_level(level::debug);
+  auto lazy = default_logger();
+  REQUIRE_NE(lazy, nullptr);
+  CHECK_EQ(lazy->name(), "");
+  CHECK_EQ(lazy->get_level(), level::debug);
+  CHECK_EQ(default_logger_raw(), lazy.get());
+
+  // 删除默认 logger 后,下一次使用得到新的实例
+  auto sink = std::make_shared<sinks::file_sink_mt>("logs/lazy.log", true);
+  set_default_logger(std::make_shared<logger>("lazy_default", sink));
+  drop("lazy_default");
+  auto rebuilt = default_logger();
+  REQUIRE_NE(rebuilt, nullptr);
+  CHECK_NE(rebuilt, lazy);
+  CHECK_EQ(rebuilt->get_level(), level::info);
+  // 未创建的默认 logger 不参与刷新
+  drop_all();
+  CHECK(flush_all_loggers().empty());
+  drop_all();
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_flush_worker_pool") {
+  std::cout << "\n========== 测试21:常驻刷新线程池 ==========\n";
+  // 反复执行批次只复用同一组线程,每项恰好执行一次
+  details::worker_pool pool(3);
+  CHECK_EQ(pool.thread_count(), 0);
+  std::vector<std::atomic<int>> hits(64);
+  std::mutex ids_mutex;
+  std::set<std::thread::id> ids;
+  for (int round = 0; round < 200; round++) {
+    pool.run(hits.size(), [&](size_t i) {
+      hits[i]++;
+      std::lock_guard<std::mutex> lock(ids_mutex);
+      ids.insert(std::this_thread::get_id());
+    });
+  }
+  CHECK_EQ(pool.thread_count(), 3);
+  CHECK_LE(ids.size(), 4);
+  bool all_done = true;
+  for (const auto &h : hits) {
+    all_done = all_done && h.load() == 200;
+  }
+  CHECK(all_done);
+
+  // 1ms 周期刷新期间多次手动刷新,结果完整
+  drop_all();
+  register_logger(std::make_shared<logger>(
+      "pool_a",
+      std::make_shared<sinks::file_sink_mt>("logs/pool_a.log", true)));
+  register_logger(std::make_shared<logger>(
+      "pool_b",
+      std::make_shared<sinks::file_sink_mt>("logs/pool_b.log", true)));
+  flush_every(std::chrono::milliseconds(1));
+  bool complete = true;
+  for (int i = 0; i < 100; i++) {
+    complete = complete && flush_all_loggers().size() == 2;
+  }
+  CHECK(complete);
+  drop_all();
+}
+
+// NOLINTNEXTLINE
+TEST_CASE("test_drop_reclaims_logger") {
+  std::cout << "\n========== 测试22:drop 立即销毁 logger ==========\n";
+  drop_all();
+  auto make = [](const std::string &name) {
+    return std::make_shared<logger>(
+        name, std::make_shared<sinks::file_sink_mt>("logs/" + name + ".log",
+                                                    true));
+  };
+  // 只留 weak_ptr,注册表是唯一的所有者
+  std::weak_ptr<logger> named;
+  std::weak_ptr<logger> fallback;
+  {
+    auto owner = make("reclaim_named");
+    named = owner;
+    register_logger(std::move(owner));
+    owner = make("reclaim_default");
+    fallback = owner;
+    set_default_logger(std::move(owner));
+  }
+
+  // 另一个线程查找后保持空闲,线程本地缓存仍指向旧版本
+  std::atomic<int> stage{0};
+  std::thread reader([&stage] {
+    CHECK_NE(get_logger_raw("reclaim_named"), nullptr);
+    CHECK_NE(get_logger("reclaim_named"), nullptr);
+    CHECK_EQ(default_logger_raw()->name(), "reclaim_default");
+    info("cached by reader");
+    stage = 1;
+    while (stage != 2) {
+      std::this_thread::yield();
+    }
+    // 持有 pin 期间替换默认 logger,只推迟销毁
+    {
+      auto pinned = pinned_default_logger();
+      stage = 3;
+      while (stage != 4) {
+        std::this_thread::yield();
+      }
+      pinned->info("still alive");
+    }
+    stage = 5;
+  });
+  while (stage != 1) {
+    std::this_thread::yield();
+  }
+  drop("reclaim_named");
+  CHECK(named.expired());
+  drop("reclaim_default");
+  CHECK(fallback.expired());
+  CHECK_EQ(get_logger_raw("reclaim_named"), nullptr);
+
+  std::weak_ptr<logger> pinned;
+  {
+    auto owner = make("reclaim_pinned");
+    pinned = owner;
+    set_default_logger(std::move(owner));
+  }
+  stage = 2;
+  while (stage != 3) {
+    std::this_thread::yield();
+  }
+  drop("reclaim_pinned");
+  CHECK_FALSE(pinned.expired());
+  stage = 4;
+  while (stage != 5) {
+    std::this_thread::yield();
+  }
+  reader.join();
+  // pin 释放后,下一次写操作回收
+  drop_all();
+  CHECK(pinned.expired());
+}
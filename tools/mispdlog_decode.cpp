@@ -0,0 +1,35 @@
+#include "mispdlog/details/binary_format.h"
+#include "mispdlog/details/log_message.h"
+#include "mispdlog/pattern_formatter.h"
+#include <cstdio>
+#include <exception>
+#include <fmt/core.h>
+#include <string>
+
+/**
+ * @brief decode a binary_file_sink log to text with pattern_formatter
+ *
+ * usage: mispdlog-decode <file> [pattern]
+ */
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    fmt::print(stderr, "usage: {} <file> [pattern]\n", argv[0]);
+    return 2;
+  }
+  try {
+    mispdlog::details::binary_reader reader(argv[1]);
+    std::string pattern = argc == 3 ? argv[2] : mispdlog::default_pattern;
+    mispdlog::pattern_formatter formatter(pattern);
+    mispdlog::details::log_message msg;
+    mispdlog::memory_buf_t buf;
+    while (reader.next(msg)) {
+      buf.clear();
+      formatter.format(msg, buf);
+      std::fwrite(buf.data(), 1, buf.size(), stdout);
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "mispdlog-decode: {}\n", e.what());
+    return 1;
+  }
+  return 0;
+}